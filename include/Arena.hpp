@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief One memory block the field arrays are carved from
+ *
+ * The block is mapped at once and handed out in page aligned pieces, which
+ * are released all together with the arena. Mapping does not touch the
+ * memory, so every page is placed on the NUMA node of the thread that
+ * writes it first. The block may be backed by huge pages, either
+ * transparent ones (a hint to the kernel) or explicit ones from the
+ * reserved pool, falling back to normal pages if none are left.
+ */
+class Arena {
+  public:
+    /// Backing pages of the block
+    enum class Pages { normal, transparent, huge };
+
+    /**
+     * @brief Constructor mapping the block
+     *
+     * @param[in] size of the block in bytes
+     * @param[in] backing pages
+     */
+    Arena(std::size_t bytes, Pages pages);
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Piece of the block
+     *
+     * @param[in] size of the piece in bytes
+     * @param[out] start of the piece, null if the block is used up
+     */
+    void *allocate(std::size_t bytes);
+
+    /// Whether the memory belongs to the block
+    bool owns(const void *memory) const;
+
+    /// Size of the pieces of a number of bytes, page aligned
+    static std::size_t piece_size(std::size_t bytes);
+
+    /**
+     * @brief Writes where the used pages of the block are placed
+     *
+     * Lists the pages on every NUMA node and the share backed by huge pages,
+     * as reported by the kernel.
+     *
+     * @param[in] stream to write to
+     */
+    void report(std::ostream &out) const;
+
+    /// Pages from the name given in the input file: none, transparent or
+    /// explicit
+    static Pages pages(const std::string &name);
+
+  private:
+    char *_base{nullptr};
+    std::size_t _size{0};
+    std::size_t _used{0};
+    Pages _pages{Pages::normal};
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Case.hpp"
+#include "Datastructures.hpp"
+
+/**
+ * @brief Advances up to batch_width cases of the same grid together
+ *
+ * The fields of the cases are interleaved, every grid location holding the
+ * values of all cases in one Lanes structure. The stencils, boundary
+ * conditions and SOR sweeps thus traverse the grid once for the whole batch
+ * and evaluate every stencil for all cases with SIMD instructions.
+ *
+ * The cases may differ in viscosity, safety factor, wall velocity, initial
+ * values, relaxation factor, solver tolerances, end time and output
+ * interval. Every case keeps its own timestep size and time. Cases whose
+ * pressure has converged are masked out of further SOR sweeps, and cases
+ * which reached their end time are frozen, so every case produces the same
+ * results as when it is simulated on its own.
+ */
+class BatchedCase {
+  public:
+    /// Smallest number of cases worth a batch. All batch_width lanes are
+    /// computed whatever the number of cases, which costs about as much as
+    /// four separate runs.
+    static constexpr int min_cases = 5;
+
+    /**
+     * @brief Whether two cases can be advanced in one batch
+     *
+     * Both cases have to be batchable, share the grid and use the same
+     * upwinding coefficient.
+     *
+     * @param[in] first case of the batch
+     * @param[in] case to be added to the batch
+     */
+    static bool compatible(const Case &first, const Case &other);
+
+    /**
+     * @brief Constructor of the batch
+     *
+     * @param[in] up to batch_width compatible cases
+     */
+    explicit BatchedCase(std::vector<std::unique_ptr<Case>> cases);
+
+    /// Simulates all cases of the batch until their end times
+    void simulate();
+
+  private:
+    /// Wall conditions of the moving and fixed walls for all cases
+    void apply_boundaries();
+
+    /// Pressure conditions of the walls only, applied after every sweep
+    void apply_pressure_boundaries();
+
+    /// Timestep sizes of the running cases, zero for the others
+    void calculate_dt();
+
+    void calculate_fluxes();
+
+    /// Fluxes F and G with the stencils of one scheme and spacing, the same
+    /// as those of Fields
+    template <convection_scheme S, grid_spacing G> void momentum_fluxes();
+
+    void calculate_rs();
+    void calculate_velocities();
+
+    /// SOR sweep updating the pressure of the cases flagged in _sweep
+    void sor_sweep();
+
+    /// RMS residuals of the pressure Poisson equations
+    Lanes calculate_residual() const;
+
+    /// Copies the fields of a case back to it, e.g. for the output
+    void store(int lane);
+
+    std::vector<std::unique_ptr<Case>> _cases;
+    std::shared_ptr<const Grid> _grid;
+    /// Stencils of the first case, the same for all cases of the batch
+    const Discretization *_discretization;
+    /// momentum_fluxes of the scheme and spacing of the discretization
+    void (BatchedCase::*_momentum_fluxes)(){nullptr};
+
+    Matrix<Lanes> _U;
+    Matrix<Lanes> _V;
+    Matrix<Lanes> _P;
+    Matrix<Lanes> _F;
+    Matrix<Lanes> _G;
+    Matrix<Lanes> _RS;
+
+    Lanes _nu;
+    Lanes _tau;
+    Lanes _omega;
+    Lanes _wall_velocity;
+    Lanes _dt;
+
+    /// Cases which have not reached their end time
+    bool _running[batch_width];
+    /// Cases whose pressure is updated by the next SOR sweep
+    bool _sweep[batch_width];
+};
@@ -19,6 +19,14 @@ class Boundary {
    * @param[in] Field to be applied
    */
   virtual void apply(Fields &field) = 0;
+
+  /**
+   * @brief Patches only the pressure ghost values, as needed between the
+   * sweeps of the pressure solver
+   *
+   * @param[in] Field to be applied
+   */
+  virtual void apply_pressure(Fields &field) = 0;
   virtual ~Boundary() = default;
 };
 
@@ -33,6 +41,7 @@ class FixedWallBoundary : public Boundary {
                     std::map<int, double> wall_temperature);
   virtual ~FixedWallBoundary() = default;
   virtual void apply(Fields &field);
+  virtual void apply_pressure(Fields &field);
 
  private:
   std::vector<Cell *> _cells;
@@ -52,6 +61,7 @@ class MovingWallBoundary : public Boundary {
                      std::map<int, double> wall_temperature);
   virtual ~MovingWallBoundary() = default;
   virtual void apply(Fields &field);
+  virtual void apply_pressure(Fields &field);
 
  private:
   std::vector<Cell *> _cells;
@@ -1,15 +1,24 @@
 #pragma once
 
+#include <deque>
+#include <fstream>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Boundary.hpp"
+#include "CollectiveOutput.hpp"
 #include "Discretization.hpp"
 #include "Domain.hpp"
 #include "Fields.hpp"
+#include "FlowState.hpp"
 #include "Grid.hpp"
+#include "Monitors.hpp"
 #include "PressureSolver.hpp"
+#include "Snapshot.hpp"
+#include "Statistics.hpp"
 
 /**
  * @brief Class to hold and orchestrate the simulation flow.
@@ -27,6 +36,22 @@ class Case {
      */
     Case(std::string file_name, int argn, char **args);
 
+    /**
+     * @brief Constructor for one variant of a case
+     *
+     * The overrides are applied after the input file, as if they were
+     * appended to it. A named variant writes its results, the terminal
+     * output and the residual log into the subdirectory of that name of the
+     * output directory, so variants can run concurrently in one process.
+     *
+     * @param[in] Input file name
+     * @param[in] pairs of input keys and values replacing the ones of the file
+     * @param[in] name of the variant, empty for the plain case
+     * @param[in] cache to share the grid with other cases, may be null
+     */
+    Case(std::string file_name, const std::vector<std::pair<std::string, std::string>> &overrides,
+         const std::string &variant, GridCache *grids);
+
     /**
      * @brief Main function to simulate the flow until the end time.
      *
@@ -39,6 +64,9 @@ class Case {
     void simulate();
 
   private:
+    /// Batches read the parameters and write the output of their cases
+    friend class BatchedCase;
+
     /// Plain case name without paths
     std::string _case_name;
     /// Output directiory name
@@ -53,9 +81,19 @@ class Case {
     /// Solution file outputting frequency
     double _output_freq;
 
+    /// Name of the variant, empty for the plain case
+    std::string _variant;
+    /// Input file and overrides, for the coarse cases of the bootstrapping
+    std::string _file_name;
+    std::vector<std::pair<std::string, std::string>> _overrides;
+
+    /// Terminal output, redirected to a file for named variants
+    std::ostream *_out;
+    std::ofstream _out_file;
+
     Fields _field;
-    Grid _grid;
-    Discretization _discretization;
+    /// Grid, possibly shared with other cases of the process
+    std::shared_ptr<const Grid> _grid;
     std::unique_ptr<PressureSolver> _pressure_solver;
     std::vector<std::unique_ptr<Boundary>> _boundaries;
 
@@ -65,6 +103,84 @@ class Case {
     /// Maximum number of iterations for the solver
     int _max_iter;
 
+    /// Pressure solver selection: SOR, FFT or auto
+    std::string _solver_name{"SOR"};
+
+    /// Whether the SOR relaxation factor is adapted during the run
+    bool _omg_adaptive{false};
+
+    /// Order of the pressure extrapolation used as initial guess (0: off)
+    int _p_extrapolation{0};
+
+    /// Steady state detection: the run stops when the relative change of
+    /// U, V and P per unit time drops below _steady_tol, or when it stays
+    /// below _steady_plateau_tol without decreasing over _steady_window
+    /// time steps (0: disabled)
+    double _steady_tol{0.0};
+    double _steady_plateau_tol{0.0};
+    int _steady_window{50};
+
+    /// Velocity of the moving wall
+    double _wall_velocity;
+    /// Initial SOR relaxation factor
+    double _omg;
+    /// Whether the case can be advanced in a batch: explicit Euler with
+    /// explicit viscous terms, fixed SOR relaxation and no warm start,
+    /// steady state detection, bootstrapping, state output, monitors,
+    /// statistics or views
+    bool _batchable{false};
+
+    /// Number of coarser grids the case is bootstrapped from, each one
+    /// simulated until its flow is steady to _bootstrap_tol
+    int _bootstrap_levels{0};
+    double _bootstrap_tol{1e-3};
+    /// Whether the final state is written for later runs
+    bool _write_state{false};
+
+    /// Probes, lines and wall forces, sampled every _monitor_interval steps
+    Monitors _monitors;
+    int _monitor_interval{1};
+
+    /// Fields written by output_vtk, the derived ones computed at output
+    bool _output_pressure{true};
+    bool _output_velocity{true};
+    bool _output_vorticity{false};
+    bool _output_stream_function{false};
+    bool _output_divergence{false};
+
+    /// Solution files as compressed snapshots instead of VTK files
+    bool _compressed{false};
+    SnapshotCodec _snapshots;
+    /// Solution files of all processes written into one file with MPI-IO
+    bool _collective{false};
+    CollectiveOutput _collective_output;
+
+    /**
+     * @brief Part of the domain written at its own time interval
+     *
+     * A view covers the inner cells imin to imax and jmin to jmax, found
+     * from the box x0, y0, x1, y1. Blocks of stride x stride cells are
+     * written as one cell, with the values of the centre cell of the block
+     * or, if averaged, with the mean of the block.
+     */
+    struct OutputView {
+        std::string name;
+        double x0, y0, x1, y1;
+        int imin, jmin, imax, jmax;
+        int stride;
+        bool average;
+        double interval;
+        double next;
+    };
+    std::vector<OutputView> _views;
+
+    /// Running statistics from _statistics_start on, written every
+    /// _statistics_interval (0: at the end only)
+    Statistics _statistics;
+    bool _statistics_on{false};
+    double _statistics_start{0.0};
+    double _statistics_interval{0.0};
+
     /**
      * @brief Creating file names from given input data file
      *
@@ -80,11 +196,80 @@ class Case {
      *
      * Outputs the solution files in .vtk format. Ghost cells are excluded.
      * Pressure is cell variable while velocity is point variable while being
-     * interpolated to the cell faces
+     * interpolated to the cell faces. Vorticity and stream function are
+     * point variables and the divergence is a cell variable, each written
+     * if selected with output_fields.
      *
      * @param[in] Timestep of the solution
      */
     void output_vtk(int t, int my_rank = 0);
 
+    /**
+     * @brief Solution outputter of the selected format
+     *
+     * Outputs a compressed snapshot of the velocities and the pressure, ghost
+     * cells included, or the pressure and velocity of all processes into
+     * one binary VTK file if selected with output_format, else calls
+     * output_vtk.
+     *
+     * @param[in] Timestep of the solution
+     * @param[in] Time of the solution
+     */
+    void output(int timestep, double t);
+
+    /**
+     * @brief View outputter
+     *
+     * Outputs pressure and velocities of the cells of a view, both as cell
+     * variables of the blocks, in .vtk format.
+     *
+     * @param[in] view to be written
+     * @param[in] Timestep of the solution
+     */
+    void output_view(const OutputView &view, int timestep);
+
+    /**
+     * @brief Statistics outputter
+     *
+     * Outputs mean, RMS of the fluctuations, minimum and maximum of the
+     * velocities and the pressure in the cell centres, and the Reynolds
+     * stresses if accumulated, as cell data in .vtk format.
+     *
+     * @param[in] Timestep of the statistics
+     */
+    void output_statistics(int timestep);
+
+    /**
+     * @brief Checks the steady state criteria after a time step
+     *
+     * @param[in] history of the largest relative change of the previous
+     * time steps, the current one is appended
+     * @param[out] reason why the flow is steady, empty if it is not
+     */
+    std::string steady_state(std::deque<double> &history) const;
+
+    /**
+     * @brief Initialises the fields from the same case on a coarser grid
+     *
+     * The coarse case is simulated until its flow is steady, itself being
+     * bootstrapped from a coarser grid until no levels are left, and its
+     * flow is interpolated onto this grid.
+     */
+    void bootstrap();
+
+    /// Fields of the case with applied boundary conditions
+    FlowState current_state();
+
     void build_domain(Domain &domain, int imax_domain, int jmax_domain);
+
+    /**
+     * @brief Cell widths of a stretched grid direction
+     *
+     * @param[in] length of the domain in this direction
+     * @param[in] number of inner cells
+     * @param[in] stretching: none, tanh (clustered at both walls) or geometric
+     * @param[in] stretching factor: tanh parameter or ratio of neighbouring cells
+     * @param[out] widths of all cells, including the two ghost cells
+     */
+    static std::vector<double> cell_widths(double length, int n, const std::string &stretching, double factor);
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Solution files of all subdomains in one shared file
+ *
+ * The file is a binary legacy VTK rectilinear grid with the pressure as cell
+ * data and the velocity interpolated to the cell corners as point data, the
+ * points placed like the ones of Case::output_vtk. The layout follows from
+ * the global grid size alone, so every process knows the offsets of its part:
+ * rank 0 writes the text lines and every process writes its block of each
+ * array with one collective MPI-IO call through a subarray file view. The
+ * corners on the boundary between two subdomains belong to the left and
+ * lower one.
+ *
+ * With collective buffering, the MPI library gathers the blocks on a number
+ * of aggregator processes, which write large contiguous pieces of the file.
+ */
+class CollectiveOutput {
+  public:
+    CollectiveOutput() = default;
+
+    /**
+     * @brief Constructor
+     *
+     * @param[in] communicator of all processes of the case
+     * @param[in] number of processes writing to the file, 0 leaving it to
+     * the MPI library
+     */
+    CollectiveOutput(MPI_Comm communicator, int writers);
+
+    /**
+     * @brief Writes the fields of the own subdomain, called by all processes
+     *
+     * @param[in] name of the file
+     * @param[in] title line of the file
+     * @param[in] fields of the subdomain
+     * @param[in] grid of the subdomain
+     * @param[out] whether the file could be written
+     */
+    bool write(const std::string &file_name, const std::string &title, Fields &field, const Grid &grid) const;
+
+  private:
+    /**
+     * @brief Writes the local block of a global array of doubles
+     *
+     * @param[in] file handle
+     * @param[in] offset of the array in the file in bytes
+     * @param[in] global sizes, slowest index first
+     * @param[in] start of the local block
+     * @param[in] sizes of the local block, no block if one is zero
+     * @param[in] values of the block, in big endian byte order
+     */
+    static int write_block(MPI_File file, MPI_Offset offset, const std::vector<int> &sizes,
+                           const std::vector<int> &starts, const std::vector<int> &block,
+                           const std::vector<double> &values);
+
+    MPI_Comm _communicator{MPI_COMM_WORLD};
+    int _writers{0};
+};
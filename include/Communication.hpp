@@ -0,0 +1,32 @@
+#pragma once
+
+#include <mpi.h>
+
+/**
+ * @brief MPI setup and information about the processes
+ *
+ * MPI is initialised once by main for all cases of the run. The threads of
+ * an ensemble do not communicate, so only the main thread calls MPI.
+ */
+class Communication {
+  public:
+    /**
+     * @brief Initialises MPI
+     *
+     * @param[in] number of command line arguments
+     * @param[in] command line arguments
+     */
+    static void init_parallel(int argn, char **args);
+
+    /// Finalises MPI
+    static void finalize();
+
+    /// Stops all processes of the run after an unrecoverable input error
+    static void abort();
+
+    /// Rank of the process in MPI_COMM_WORLD
+    static int get_rank();
+
+    /// Number of processes in MPI_COMM_WORLD
+    static int get_size();
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+/**
+ * @brief Plan for the discrete cosine transform of a fixed length
+ *
+ * Implements the DCT-II, which diagonalizes the second difference operator
+ * with homogeneous Neumann conditions on a cell centered grid, and its
+ * inverse. The transforms are computed in O(n log n) through a complex FFT
+ * of the same length, using Bluestein's algorithm for lengths which are not
+ * a power of two. All twiddle factors are precomputed once, so a plan can be
+ * reused for any number of transforms.
+ */
+class CosineTransform {
+  public:
+    CosineTransform() = default;
+
+    /**
+     * @brief Constructor of the plan
+     *
+     * @param[in] length of the transformed sequences
+     */
+    CosineTransform(int n);
+
+    /**
+     * @brief In-place DCT-II, X_k = sum_m x_m cos(pi k (2m + 1) / (2n))
+     *
+     * @param[in] pointer to the first element of the sequence
+     * @param[in] distance between consecutive elements
+     */
+    void forward(double *data, int stride = 1);
+
+    /**
+     * @brief In-place inverse of the DCT-II
+     *
+     * @param[in] pointer to the first element of the sequence
+     * @param[in] distance between consecutive elements
+     */
+    void backward(double *data, int stride = 1);
+
+    /// Length of the transformed sequences
+    int size() const;
+
+  private:
+    /// Complex FFT of length _n, the inverse one being unnormalized
+    void fft(std::vector<std::complex<double>> &a, bool inverse);
+
+    /// In-place radix-2 FFT of the power of two length _m
+    void fft_radix2(std::vector<std::complex<double>> &a, bool inverse) const;
+
+    /// Length of the transform
+    int _n{0};
+    /// Length of the radix-2 transforms (_n itself or the Bluestein length)
+    int _m{0};
+    /// Whether the Bluestein algorithm is needed
+    bool _bluestein{false};
+
+    /// Radix-2 twiddle factors exp(-2 pi i k / _m)
+    std::vector<std::complex<double>> _twiddle;
+    /// Bluestein chirp exp(-pi i k^2 / _n)
+    std::vector<std::complex<double>> _chirp;
+    /// Radix-2 FFT of the conjugate chirp sequence
+    std::vector<std::complex<double>> _chirp_fft;
+    /// DCT rotation factors exp(-pi i k / (2 _n))
+    std::vector<std::complex<double>> _shift;
+
+    /// Work buffers
+    std::vector<std::complex<double>> _buffer;
+    std::vector<std::complex<double>> _padded;
+};
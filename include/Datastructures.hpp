@@ -1,8 +1,178 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "Arena.hpp"
+
+/// Number of cases advanced together by a batch, one per lane
+constexpr int batch_width = 8;
+
+/**
+ * @brief Values of one grid location for all cases of a batch
+ *
+ * The values of the cases are stored contiguously, so a Matrix<Lanes> is an
+ * array of small structures of arrays and every lane-wise operation below
+ * compiles to a few SIMD instructions. Doubles are broadcast to all lanes,
+ * which lets the momentum stencils and the pressure stencils of
+ * Discretization evaluate batches unchanged.
+ */
+struct alignas(64) Lanes {
+  Lanes() = default;
+  Lanes(double value) {
+    for (int k = 0; k < batch_width; ++k) m[k] = value;
+  }
+
+  double m[batch_width];
+};
+
+inline Lanes operator+(const Lanes &a, const Lanes &b) {
+  Lanes r;
+  for (int k = 0; k < batch_width; ++k) r.m[k] = a.m[k] + b.m[k];
+  return r;
+}
+
+inline Lanes operator-(const Lanes &a, const Lanes &b) {
+  Lanes r;
+  for (int k = 0; k < batch_width; ++k) r.m[k] = a.m[k] - b.m[k];
+  return r;
+}
+
+inline Lanes operator*(const Lanes &a, const Lanes &b) {
+  Lanes r;
+  for (int k = 0; k < batch_width; ++k) r.m[k] = a.m[k] * b.m[k];
+  return r;
+}
+
+inline Lanes operator/(const Lanes &a, const Lanes &b) {
+  Lanes r;
+  for (int k = 0; k < batch_width; ++k) r.m[k] = a.m[k] / b.m[k];
+  return r;
+}
+
+inline Lanes operator-(const Lanes &a) {
+  Lanes r;
+  for (int k = 0; k < batch_width; ++k) r.m[k] = -a.m[k];
+  return r;
+}
+
+inline Lanes fabs(const Lanes &a) {
+  Lanes r;
+  for (int k = 0; k < batch_width; ++k) r.m[k] = std::fabs(a.m[k]);
+  return r;
+}
+
+/**
+ * @brief Allocator of the matrices, taking the memory from an arena if one
+ * is given and from the heap otherwise.
+ *
+ * Elements in arena memory are left uninitialised by a plain resize, so
+ * their pages are not touched until the owner fills them, see the arena
+ * constructor of Matrix. Pieces of the arena are released with the arena,
+ * which the allocator keeps alive. Copies of a matrix go to the heap.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() = default;
+  explicit ArenaAllocator(std::shared_ptr<Arena> arena)
+      : _arena(std::move(arena)) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other.arena()) {}
+
+  T *allocate(std::size_t n) {
+    void *memory = _arena ? _arena->allocate(n * sizeof(T)) : nullptr;
+    return memory ? static_cast<T *>(memory) : std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T *p, std::size_t n) {
+    if (!_arena || !_arena->owns(p)) {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  /// Value-initialises on the heap, default-initialises in the arena
+  template <typename U>
+  void construct(U *p) {
+    if (_arena) {
+      ::new (static_cast<void *>(p)) U;
+    } else {
+      ::new (static_cast<void *>(p)) U();
+    }
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&... args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  const std::shared_ptr<Arena> &arena() const { return _arena; }
+
+ private:
+  std::shared_ptr<Arena> _arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return !(a == b);
+}
+
+/**
+ * @brief Row or column of a matrix, viewed in place
+ *
+ * The elements are size values stride apart; rows have the stride 1 and
+ * columns the number of elements of a row.
+ */
+template <typename T>
+class MatrixSlice {
+ public:
+  MatrixSlice(T *data, int size, int stride)
+      : _data(data), _size(size), _stride(stride) {}
+
+  /// Iterator over the elements of the slice
+  class iterator {
+   public:
+    iterator(T *p, int stride) : _p(p), _stride(stride) {}
+    T &operator*() const { return *_p; }
+    iterator &operator++() {
+      _p += _stride;
+      return *this;
+    }
+    bool operator!=(const iterator &other) const { return _p != other._p; }
+
+   private:
+    T *_p;
+    int _stride;
+  };
+
+  T &operator[](int k) const { return _data[k * _stride]; }
+  int size() const { return _size; }
+  iterator begin() const { return iterator(_data, _stride); }
+  iterator end() const { return iterator(_data + _size * _stride, _stride); }
+
+ private:
+  T *_data;
+  int _size;
+  int _stride;
+};
+
 /**
  * @brief General 2D data structure around std::vector, in column
  * major format.
@@ -38,6 +208,28 @@ class Matrix {
     _container.resize(i_max * j_max);
   }
 
+  /**
+   * @brief Constructor in an arena.
+   *
+   * The elements are written first by the calling thread, which places the
+   * pages on its NUMA node. The kernels of the fields run serially on the
+   * same thread; a parallel first touch only pays off once they share its
+   * schedule.
+   *
+   * @param[in] number of elements in x direction
+   * @param[in] number of elements in y direction
+   * @param[in] initial value for the elements
+   * @param[in] arena to take the memory from
+   *
+   */
+  Matrix<T>(int i_max, int j_max, double init_val, std::shared_ptr<Arena> arena)
+      : _imax(i_max),
+        _jmax(j_max),
+        _container(ArenaAllocator<T>(std::move(arena))) {
+    _container.resize(i_max * j_max);
+    std::fill(_container.begin(), _container.end(), T(init_val));
+  }
+
   /**
    * @brief Element access and modify using index
    *
@@ -63,6 +255,13 @@ class Matrix {
    */
   const T *data() const { return _container.data(); }
 
+  /**
+   * @brief Pointer representation of underlying data for modification
+   *
+   * @param[out] pointer to the beginning of the vector
+   */
+  T *data() { return _container.data(); }
+
   /**
    * @brief Access of the size of the structure
    *
@@ -70,22 +269,24 @@ class Matrix {
    */
   int size() const { return _container.size(); }
 
-  /// get the given row of the matrix
-  std::vector<double> get_row(int row) {
-    std::vector<T> row_data(_imax, -1);
-    for (int i = 0; i < _imax; ++i) {
-      row_data.at(i) = _container.at(i + _imax * row);
-    }
-    return row_data;
+  /// get the given row of the matrix, viewed in place
+  MatrixSlice<T> get_row(int row) {
+    return MatrixSlice<T>(_container.data() + _imax * row, _imax, 1);
   }
 
-  /// get the given column of the matrix
-  std::vector<double> get_col(int col) {
-    std::vector<T> col_data(_jmax, -1);
-    for (int i = 0; i < _jmax; ++i) {
-      col_data.at(i) = _container.at(col + i * _imax);
-    }
-    return col_data;
+  /// get the given row of the matrix, viewed in place
+  MatrixSlice<const T> get_row(int row) const {
+    return MatrixSlice<const T>(_container.data() + _imax * row, _imax, 1);
+  }
+
+  /// get the given column of the matrix, viewed in place
+  MatrixSlice<T> get_col(int col) {
+    return MatrixSlice<T>(_container.data() + col, _jmax, _imax);
+  }
+
+  /// get the given column of the matrix, viewed in place
+  MatrixSlice<const T> get_col(int col) const {
+    return MatrixSlice<const T>(_container.data() + col, _jmax, _imax);
   }
 
   /// set the given column of matrix to given vector
@@ -115,5 +316,5 @@ class Matrix {
   int _jmax;
 
   /// Data container
-  std::vector<T> _container;
+  std::vector<T, ArenaAllocator<T>> _container;
 };
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Grid.hpp"
+
+/**
+ * @brief Division of the domain into one rectangular subdomain per process
+ *
+ * The uniform decomposition cuts the domain into iproc x jproc subdomains of
+ * (almost) equal size. The fluid-weighted one uses recursive coordinate
+ * bisection: a box of n subdomains is cut across its longer side into boxes
+ * of n / 2 and n - n / 2 subdomains, at the position where the fluid cells
+ * per subdomain of both sides are closest, until every box is one subdomain.
+ * Solid regions thus end up in large subdomains and every process gets about
+ * the same number of fluid cells.
+ *
+ * The fluid cells of any box are counted in constant time from the prefix
+ * sums of the fluid cells of the grid.
+ */
+class Decomposition {
+  public:
+    /// Subdomain of the inner cells imin + 1 to imin + size_x and jmin + 1
+    /// to jmin + size_y, with the offsets of Domain
+    struct Box {
+        int imin;
+        int jmin;
+        int size_x;
+        int size_y;
+    };
+
+    /**
+     * @brief Constructor counting the fluid cells of the grid
+     *
+     * @param[in] grid of the whole domain
+     */
+    explicit Decomposition(const Grid &grid);
+
+    /**
+     * @brief Uniform decomposition
+     *
+     * @param[in] number of subdomains in x direction
+     * @param[in] number of subdomains in y direction
+     * @param[out] subdomains, row by row
+     */
+    std::vector<Box> uniform(int iproc, int jproc) const;
+
+    /**
+     * @brief Fluid-weighted decomposition by recursive coordinate bisection
+     *
+     * @param[in] number of subdomains
+     * @param[out] subdomains
+     */
+    std::vector<Box> bisection(int parts) const;
+
+    /// Number of fluid cells of a subdomain
+    int fluid_cells(const Box &box) const;
+
+    /**
+     * @brief Writes the subdomains with their cells and the imbalance
+     *
+     * The imbalance is the largest number of fluid cells of a subdomain
+     * divided by the mean, the factor by which the slowest process lags
+     * behind a perfect balance. The halo is the number of cell faces
+     * between subdomains, the amount of data exchanged per field.
+     *
+     * @param[in] stream to write to
+     * @param[in] name of the decomposition
+     * @param[in] subdomains
+     */
+    void report(std::ostream &out, const std::string &name, const std::vector<Box> &boxes) const;
+
+    /// Largest number of fluid cells of a subdomain divided by the mean
+    double imbalance(const std::vector<Box> &boxes) const;
+
+  private:
+    /// Splits the box into parts subdomains, appending them
+    void bisect(const Box &box, int parts, std::vector<Box> &boxes) const;
+
+    int _imax;
+    int _jmax;
+    /// Fluid cells of the inner cells 1 to i and 1 to j at (i, j)
+    std::vector<int> _prefix;
+};
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <vector>
+
 #include "Datastructures.hpp"
+#include "Enums.hpp"
+#include "Stencils.hpp"
 
 /**
- * @brief Static discretization methods to modify the fields
+ * @brief Discretization stencils on the cell sizes of one grid
  *
+ * Every case holds its own instance, so several cases with different grids
+ * can run in one process. The pressure stencils are instantiated for double
+ * and for Lanes, evaluating the same stencil for all cases of a batch at
+ * once; the momentum stencils are the ones of MomentumStencil, with the
+ * factors of coefficients().
  */
 class Discretization {
   public:
@@ -13,48 +22,30 @@ class Discretization {
     /**
      * @brief Constructor to set the discretization parameters
      *
-     * @param[in] cell size in x direction
-     * @param[in] cell size in y direction
+     * The stencils support non-uniform grids, the velocities being located
+     * in the middle of the faces and the pressure in the middle of the cells.
+     *
+     * @param[in] cell sizes in x direction, including the ghost cells
+     * @param[in] cell sizes in y direction, including the ghost cells
      * @param[in] upwinding coefficient
      */
-    Discretization(double dx, double dy, double gamma);
+    Discretization(const std::vector<double> &dx, const std::vector<double> &dy, double gamma);
 
     /**
-     * @brief Diffusion discretization in 2D using central differences
+     * @brief Laplacian term discretization using central difference
      *
      * @param[in] data to be discretized
      * @param[in] x index
      * @param[in] y index
-     *
-     */
-    static double diffusion(const Matrix<double> &A, int i, int j);
-
-    /**
-     * @brief Convection in x direction using donor-cell scheme
-     *
-     * @param[in] x-velocity field
-     * @param[in] y-velocity field
-     * @param[in] x index
-     * @param[in] y index
-     * @param[out] result
-     *
-     */
-    static double convection_u(const Matrix<double> &U, const Matrix<double> &V, int i, int j);
-
-    /**
-     * @brief Convection in y direction using donor-cell scheme
-     *
-     * @param[in] x-velocity field
-     * @param[in] y-velocity field
-     * @param[in] x index
-     * @param[in] y index
      * @param[out] result
      *
      */
-    static double convection_v(const Matrix<double> &U, const Matrix<double> &V, int i, int j);
+    template <typename T>
+    T laplacian(const Matrix<T> &P, int i, int j) const;
 
     /**
-     * @brief Laplacian term discretization using central difference
+     * @brief Terms of laplacian needed for SOR, i.e. excluding unknown value at
+     * (i,j)
      *
      * @param[in] data to be discretized
      * @param[in] x index
@@ -62,19 +53,19 @@ class Discretization {
      * @param[out] result
      *
      */
-    static double laplacian(const Matrix<double> &P, int i, int j);
+    template <typename T>
+    T sor_helper(const Matrix<T> &P, int i, int j) const;
 
     /**
-     * @brief Terms of laplacian needed for SOR, i.e. excluding unknown value at
-     * (i,j)
+     * @brief Coefficient of the unknown value at (i,j) in the negative
+     * laplacian, i.e. laplacian = sor_helper - laplacian_diagonal * P(i,j)
      *
-     * @param[in] data to be discretized
      * @param[in] x index
      * @param[in] y index
      * @param[out] result
      *
      */
-    static double sor_helper(const Matrix<double> &P, int i, int j);
+    double laplacian_diagonal(int i, int j) const;
 
     /**
      * @brief Compute interpolated value in the middle between two grid points via linear interpolation.
@@ -87,10 +78,28 @@ class Discretization {
      * @param[out] result
      *
      */
-    static double interpolate(const Matrix<double> &A, int i, int j, int i_offset, int j_offset);
+    double interpolate(const Matrix<double> &A, int i, int j, int i_offset, int j_offset) const;
+
+    /// upwinding coefficient
+    double gamma() const { return _gamma; }
+
+    /// convection scheme of the upwinding coefficient
+    convection_scheme scheme() const;
+
+    /// whether the cell widths are constant in each direction
+    grid_spacing spacing() const;
+
+    /// factors of the momentum stencils, see MomentumStencil
+    const StencilCoefficients &coefficients() const { return _coefficients; }
 
   private:
-    static double _dx;
-    static double _dy;
-    static double _gamma;
+    /// Cell sizes including the ghost cells
+    std::vector<double> _dx;
+    std::vector<double> _dy;
+    /// Distances between neighbouring cell centres, _dx_centres[i] being the
+    /// one between the cells i and i + 1
+    std::vector<double> _dx_centres;
+    std::vector<double> _dy_centres;
+    double _gamma{0.0};
+    StencilCoefficients _coefficients;
 };
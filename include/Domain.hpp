@@ -1,6 +1,7 @@
 #pragma once
 #include "Enums.hpp"
 #include <mpi.h>
+#include <vector>
 
 /**
  * @brief Data structure that holds geometrical information
@@ -23,6 +24,11 @@ struct Domain {
     /// Cell height
     double dy{-1.0};
 
+    /// Cell lengths of all columns, including the ghost columns
+    std::vector<double> dx_cells;
+    /// Cell heights of all rows, including the ghost rows
+    std::vector<double> dy_cells;
+
     /// Number of cells in x direction
     int size_x{-1};
     /// Number of cells in y direction
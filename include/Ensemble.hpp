@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Grid.hpp"
+
+/**
+ * @brief Variant of a case, given by the input keys it changes
+ */
+struct Variant {
+    /// Name of the variant, also the name of its output subdirectory
+    std::string name;
+    /// Pairs of input keys and values replacing the ones of the input file
+    std::vector<std::pair<std::string, std::string>> overrides;
+};
+
+/**
+ * @brief Runs many variants of one case concurrently in one process
+ *
+ * The variants are read from an ensemble file with one variant per line,
+ * the name followed by pairs of input keys and values, e.g.
+ *
+ *     re400 nu 0.0025 tau 0.8
+ *     fine  imax 100 jmax 100
+ *
+ * Lines starting with '#' are comments. A pool of worker threads takes the
+ * variants in order, every worker running one case at a time, so parameter
+ * studies of many small cases use all cores without starting a process per
+ * case. Variants with the same geometry and cell sizes share one grid.
+ *
+ * In batched mode, every worker takes up to batch_width consecutive
+ * variants at a time and advances the compatible ones together in one
+ * BatchedCase, the others one after another.
+ */
+class Ensemble {
+  public:
+    /**
+     * @brief Constructor of the ensemble
+     *
+     * @param[in] input file of the case the variants are based on
+     * @param[in] ensemble file listing the variants
+     * @param[in] number of worker threads, 0 for the number of cores
+     * @param[in] whether compatible variants are advanced in batches
+     */
+    Ensemble(std::string case_file, std::string ensemble_file, int threads = 0, bool batch = false);
+
+    /// Runs all variants and prints the wall time of each
+    void run();
+
+    /// Variants read from the ensemble file
+    const std::vector<Variant> &variants() const;
+
+  private:
+    std::string _case_file;
+    std::vector<Variant> _variants;
+    int _threads;
+    bool _batch;
+    /// Grids shared by the variants
+    GridCache _grids;
+};
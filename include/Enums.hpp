@@ -31,3 +31,31 @@ enum class cell_type {
   MOVING_WALL,
   DEFAULT
 };
+
+// Time discretization of the viscous terms in the momentum equations
+enum class viscous_scheme {
+  EXPLICIT,
+  BACKWARD_EULER,
+  CRANK_NICOLSON
+};
+
+// Time integration scheme of the convective (and explicit viscous) terms
+enum class time_integrator {
+  EULER,
+  ADAMS_BASHFORTH_2,
+  RUNGE_KUTTA_3
+};
+
+// Convection scheme selected from the upwinding coefficient gamma: central
+// differences (0), donor cell (1) or a blend of both
+enum class convection_scheme {
+  CENTRAL,
+  HYBRID,
+  UPWIND
+};
+
+// Cell widths of a grid, constant in each direction or stretched
+enum class grid_spacing {
+  UNIFORM,
+  STRETCHED
+};
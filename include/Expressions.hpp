@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vector>
+
+#include "Datastructures.hpp"
+
+/**
+ * @brief Whole-array stencil expressions on matrices
+ *
+ * An expression such as (at(F) - at(F, -1, 0)) / along_x(dx) only records
+ * its operands; nothing is computed until assign_row evaluates it element
+ * by element in a single loop over a row. Every element thus costs one pass
+ * over the contiguous row data without temporary matrices or bounds checks,
+ * which the compiler can vectorize. The operands are:
+ *
+ * - at(A, di, dj): the matrix A shifted by (di, dj), i.e. A(i + di, j + dj)
+ * - along_x(w, k), along_y(w, k): weights per column w[i + k] or per row
+ *   w[j + k], e.g. the cell widths
+ * - numbers, which are the same for all elements, or the Lanes of a batch
+ *
+ * combined with +, -, * and /. The matrix assigned to must not appear
+ * shifted in the expression, as its elements are overwritten in the loop.
+ */
+namespace expr {
+
+/// Base of the expressions, E evaluating the element (i, j) with operator()
+template <typename E> struct Expression {
+    const E &self() const { return static_cast<const E &>(*this); }
+};
+
+/// Matrix shifted by (di, dj)
+template <typename T> class Shifted : public Expression<Shifted<T>> {
+  public:
+    Shifted(const Matrix<T> &A, int di, int dj) : _data(A.data()), _offset(di + A.imax() * dj), _stride(A.imax()) {}
+    T operator()(int i, int j) const { return _data[_offset + i + _stride * j]; }
+
+  private:
+    const T *_data;
+    int _offset;
+    int _stride;
+};
+
+/// Weights per column, w[i + offset]
+class AlongX : public Expression<AlongX> {
+  public:
+    AlongX(const std::vector<double> &w, int offset) : _w(w.data()), _offset(offset) {}
+    double operator()(int i, int) const { return _w[_offset + i]; }
+
+  private:
+    const double *_w;
+    int _offset;
+};
+
+/// Weights per row, w[j + offset]
+class AlongY : public Expression<AlongY> {
+  public:
+    AlongY(const std::vector<double> &w, int offset) : _w(w.data()), _offset(offset) {}
+    double operator()(int, int j) const { return _w[_offset + j]; }
+
+  private:
+    const double *_w;
+    int _offset;
+};
+
+/// Number, respectively values of all lanes, used for all elements
+template <typename T> class Constant : public Expression<Constant<T>> {
+  public:
+    explicit Constant(const T &value) : _value(value) {}
+    T operator()(int, int) const { return _value; }
+
+  private:
+    T _value;
+};
+
+/// Elementwise operation of two expressions, held by value as they only
+/// consist of pointers and numbers
+template <typename L, typename R, typename Op> class Binary : public Expression<Binary<L, R, Op>> {
+  public:
+    Binary(const L &l, const R &r) : _l(l), _r(r) {}
+    auto operator()(int i, int j) const { return Op::apply(_l(i, j), _r(i, j)); }
+
+  private:
+    L _l;
+    R _r;
+};
+
+#define EXPRESSION_OPERATOR(NAME, OP)                                                                                  \
+    struct NAME {                                                                                                      \
+        template <typename A, typename B> static auto apply(const A &a, const B &b) { return a OP b; }                \
+    };                                                                                                                 \
+    template <typename L, typename R>                                                                                  \
+    Binary<L, R, NAME> operator OP(const Expression<L> &l, const Expression<R> &r) {                                   \
+        return {l.self(), r.self()};                                                                                   \
+    }                                                                                                                  \
+    template <typename L> Binary<L, Constant<double>, NAME> operator OP(const Expression<L> &l, double r) {            \
+        return {l.self(), Constant<double>(r)};                                                                        \
+    }                                                                                                                  \
+    template <typename R> Binary<Constant<double>, R, NAME> operator OP(double l, const Expression<R> &r) {            \
+        return {Constant<double>(l), r.self()};                                                                        \
+    }                                                                                                                  \
+    template <typename L> Binary<L, Constant<Lanes>, NAME> operator OP(const Expression<L> &l, const Lanes &r) {       \
+        return {l.self(), Constant<Lanes>(r)};                                                                         \
+    }                                                                                                                  \
+    template <typename R> Binary<Constant<Lanes>, R, NAME> operator OP(const Lanes &l, const Expression<R> &r) {       \
+        return {Constant<Lanes>(l), r.self()};                                                                         \
+    }
+
+EXPRESSION_OPERATOR(Add, +)
+EXPRESSION_OPERATOR(Subtract, -)
+EXPRESSION_OPERATOR(Multiply, *)
+EXPRESSION_OPERATOR(Divide, /)
+
+#undef EXPRESSION_OPERATOR
+
+/// Matrix A shifted by (di, dj)
+template <typename T> Shifted<T> at(const Matrix<T> &A, int di = 0, int dj = 0) { return Shifted<T>(A, di, dj); }
+
+/// Weights w per column, shifted by offset
+inline AlongX along_x(const std::vector<double> &w, int offset = 0) { return AlongX(w, offset); }
+
+/// Weights w per row, shifted by offset
+inline AlongY along_y(const std::vector<double> &w, int offset = 0) { return AlongY(w, offset); }
+
+/**
+ * @brief Evaluates an expression for a segment of a row
+ *
+ * @param[in] matrix assigned to
+ * @param[in] row
+ * @param[in] first column
+ * @param[in] last column
+ * @param[in] expression
+ */
+template <typename T, typename E> void assign_row(Matrix<T> &A, int j, int i0, int i1, const Expression<E> &e) {
+    const E &x = e.self();
+    T *row = A.data() + A.imax() * j;
+    for (int i = i0; i < i1 + 1; ++i) {
+        row[i] = x(i, j);
+    }
+}
+
+} // namespace expr
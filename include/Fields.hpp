@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <vector>
+
 #include "Datastructures.hpp"
 #include "Discretization.hpp"
+#include "Enums.hpp"
 #include "Grid.hpp"
 
 /**
@@ -23,18 +27,25 @@ class Fields {
      * @param[in] initial x-velocity
      * @param[in] initial y-velocity
      * @param[in] initial pressure
+     * @param[in] pages backing the arena of the fields
      *
      */
-    Fields(double _nu, double _dt, double _tau, int imax, int jmax, double UI, double VI, double PI);
+    Fields(double _nu, double _dt, double _tau, int imax, int jmax, double UI, double VI, double PI,
+           Arena::Pages pages = Arena::Pages::normal);
 
     /**
      * @brief Calculates the convective and diffusive fluxes in x and y
      * direction based on explicit discretization of the momentum equations
      *
+     * With a semi-implicit viscous scheme, the explicit increment of the
+     * velocities is corrected by solving the Helmholtz systems of the
+     * implicit viscous part with alternating direction line solves.
+     *
      * @param[in] grid in which the fluxes are calculated
+     * @param[in] stage of the time integrator
      *
      */
-    void calculate_fluxes(Grid &grid);
+    void calculate_fluxes(const Grid &grid, int stage = 0);
 
     /**
      * @brief Right hand side calculations using the fluxes for the pressure
@@ -43,24 +54,155 @@ class Fields {
      * @param[in] grid in which the calculations are done
      *
      */
-    void calculate_rs(Grid &grid);
+    void calculate_rs(const Grid &grid);
 
     /**
      * @brief Velocity calculation using pressure values
      *
+     * With the change monitor enabled, the change of the velocities and of
+     * the pressure since the previous call is measured in the same pass.
+     *
      * @param[in] grid in which the calculations are done
      *
      */
-    void calculate_velocities(Grid &grid);
+    void calculate_velocities(const Grid &grid);
+
+    /**
+     * @brief Enables measuring the change of the fields in
+     * calculate_velocities, e.g. to detect a steady state
+     *
+     * @param[in] whether the change is measured
+     *
+     */
+    void set_change_monitor(bool enabled);
+
+    /// RMS change of U, V and P per unit time in the last call of
+    /// calculate_velocities, relative to the RMS of the new fields
+    const std::array<double, 3> &relative_change() const;
 
     /**
      * @brief Adaptive step size calculation using x-velocity condition,
      * y-velocity condition and CFL condition
      *
+     * The diffusive condition is dropped for semi-implicit viscous schemes.
+     *
+     * @param[in] grid in which the calculations are done
+     *
+     */
+    double calculate_dt(const Grid &grid);
+
+    /**
+     * @brief Selects the time integration scheme
+     *
+     * Allocates the buffers of the previous tendency for Adams-Bashforth 2,
+     * respectively the stage accumulator of the low-storage Runge-Kutta 3.
+     *
+     * @param[in] time integrator
+     *
+     */
+    void set_time_integrator(time_integrator integrator);
+
+    /// number of stages, i.e. pressure projections per time step
+    int stages() const;
+
+    /**
+     * @brief Enables local timesteps for pseudo-transient iterations towards
+     * a steady state
+     *
+     * Every face then advances the momentum with the largest stable
+     * timestep for its own cell sizes and velocities, at least the global
+     * timestep and at most the given ratio times it, while the pressure
+     * projection keeps the global timestep and the pressure increment is
+     * relaxed by the ratio of the timesteps. Only the steady state is
+     * meaningful then; it is the same as the one of the time-accurate
+     * iteration. Requires the explicit Euler integrator.
+     *
+     * @param[in] maximum ratio of the local and the global timestep (0: off)
+     *
+     */
+    void set_local_timestepping(double max_ratio);
+
+    /**
+     * @brief Selects the time discretization of the viscous terms
+     *
+     * @param[in] viscous scheme
+     *
+     */
+    void set_viscous_scheme(viscous_scheme scheme);
+
+    /**
+     * @brief Root mean square residual of the pressure Poisson equation
+     * over the fluid cells
+     *
+     * @param[in] grid in which the calculations are done
+     *
+     */
+    double calculate_residual(const Grid &grid);
+
+    /**
+     * @brief Vorticity dv/dx - du/dy in the cell corners
+     *
+     * @param[in] grid in which the calculations are done
+     * @param[out] vorticity of the corners 0 to imax and 0 to jmax
+     *
+     */
+    void calculate_vorticity(const Grid &grid, Matrix<double> &vorticity) const;
+
+    /**
+     * @brief Stream function with u = dpsi/dy and v = -dpsi/dx in the cell
+     * corners, zero in the lower left corner
+     *
+     * @param[in] grid in which the calculations are done
+     * @param[out] stream function of the corners 0 to imax and 0 to jmax
+     *
+     */
+    void calculate_stream_function(const Grid &grid, Matrix<double> &psi) const;
+
+    /**
+     * @brief Divergence of the velocities in the inner cells
+     *
      * @param[in] grid in which the calculations are done
+     * @param[out] divergence of the cells 1 to imax and 1 to jmax
+     * @param[out] largest absolute divergence of a fluid cell
      *
      */
-    double calculate_dt(Grid &grid);
+    double calculate_divergence(const Grid &grid, Matrix<double> &divergence) const;
+
+    /**
+     * @brief Enables the pressure history used to warm start the pressure
+     * solver
+     *
+     * Allocates order + 1 history buffers, i.e. two for linear and three
+     * for quadratic extrapolation.
+     *
+     * @param[in] extrapolation order (0: disabled, 1: linear, 2: quadratic)
+     *
+     */
+    void set_pressure_extrapolation(int order);
+
+    /**
+     * @brief Stores the current pressure in the history ring buffer
+     *
+     * @param[in] time level the current pressure belongs to
+     *
+     */
+    void store_pressure(double t);
+
+    /**
+     * @brief Replaces the pressure by the polynomial extrapolation of the
+     * stored history to the given time level
+     *
+     * Uses as many history levels as available, up to the configured order.
+     *
+     * @param[in] grid in which the calculations are done
+     * @param[in] time level to extrapolate to
+     * @param[out] whether enough history was available to extrapolate
+     *
+     */
+    bool extrapolate_pressure(const Grid &grid, double t);
+
+    /// Resets the pressure to the most recently stored history level
+    void restore_pressure();
 
     /// x-velocity index based access and modify
     double &u(int i, int j);
@@ -83,10 +225,37 @@ class Fields {
     /// get timestep size
     double dt() const;
 
+    /// get kinematic viscosity
+    double nu() const;
+
+    /// get adaptive timestep coefficient
+    double tau() const;
+
     /// pressure matrix access and modify
     Matrix<double> &p_matrix();
 
+    /// velocity matrices access and modify
+    Matrix<double> &u_matrix();
+    Matrix<double> &v_matrix();
+
+    /**
+     * @brief Sets the stencils of the grid the fields live on
+     *
+     * @param[in] discretization of the grid
+     *
+     */
+    void set_discretization(const Discretization &discretization);
+
+    /// stencils of the grid the fields live on
+    const Discretization &discretization() const;
+
+    /// Writes where the pages of the velocities, pressure, fluxes and right
+    /// hand side are placed
+    void memory_report(std::ostream &out) const;
+
   private:
+    /// memory of the matrices below, one page aligned piece each
+    std::shared_ptr<Arena> _arena;
     /// x-velocity matrix
     Matrix<double> _U;
     /// y-velocity matrix
@@ -110,4 +279,112 @@ class Fields {
     double _dt;
     /// adaptive timestep coefficient
     double _tau;
+
+    /// stencils of the grid, owned per case
+    Discretization _discretization;
+
+    /**
+     * @brief Momentum fluxes F and G with the stencils of one convection
+     * scheme and grid spacing
+     *
+     * @param[in] grid in which the fluxes are calculated
+     * @param[in] stage of the time integrator
+     * @param[in] whether the viscous terms are explicit
+     */
+    template <convection_scheme S, grid_spacing G>
+    void momentum_fluxes(const Grid &grid, int stage, bool explicit_viscous);
+
+    /// momentum_fluxes of the scheme and spacing of the discretization
+    void (Fields::*_momentum_fluxes)(const Grid &, int, bool){nullptr};
+
+    /// whether calculate_velocities measures the change of the fields
+    bool _monitor_change{false};
+    /// pressure of the previous call of calculate_velocities
+    Matrix<double> _P_old;
+    /// relative change of U, V and P per unit time
+    std::array<double, 3> _change{};
+
+    /// time integration scheme
+    time_integrator _time_integrator{time_integrator::EULER};
+    /// previous tendencies (Adams-Bashforth 2) or stage accumulators
+    /// (Runge-Kutta 3) of the x- and y-momentum equations
+    Matrix<double> _FN;
+    Matrix<double> _GN;
+    /// timestep size of the previous time step, zero before the first one
+    double _dt_old{0.0};
+    /// timestep size of the current stage
+    double _dt_stage{0.0};
+
+    /// whether the momentum is advanced with local timesteps
+    bool _local_dt{false};
+    /// maximum ratio of the local and the global timestep
+    double _local_dt_ratio{1.0};
+    /// local timesteps of the x- and y-velocity faces
+    Matrix<double> _DTU;
+    Matrix<double> _DTV;
+
+    /// Local timesteps of all faces, bounded by the global timestep
+    void calculate_local_dt(const Grid &grid);
+
+    /**
+     * @brief Prediction of a velocity with a local timestep
+     *
+     * @param[in] velocity
+     * @param[in] convective tendency
+     * @param[in] viscous tendency
+     * @param[in] local timestep
+     * @param[in] pressure gradient at the face
+     * @param[in] whether the viscous terms are explicit
+     *
+     */
+    double local_increment(double A, double N, double D, double dt, double grad_p, bool explicit_viscous) const;
+
+    /**
+     * @brief Velocity increment of the time integrator for the explicit
+     * tendency N, updating the stored tendency or stage accumulator
+     *
+     * @param[in] explicit tendency
+     * @param[in] stored tendencies or stage accumulators
+     * @param[in] x index
+     * @param[in] y index
+     * @param[in] stage of the time integrator
+     *
+     */
+    double increment(double N, Matrix<double> &stored, int i, int j, int stage) const;
+
+    /// time discretization of the viscous terms
+    viscous_scheme _viscous_scheme{viscous_scheme::EXPLICIT};
+    /// lower, main and upper diagonal and right hand side of the line solves
+    std::vector<double> _line_a;
+    std::vector<double> _line_b;
+    std::vector<double> _line_c;
+    std::vector<double> _line_d;
+
+    /**
+     * @brief Solves the implicit viscous part for the increment F - U,
+     * respectively G - V, with one line solve per direction
+     *
+     * The lines are solved on their runs of faces between two fluid cells.
+     * The increment vanishes on the walls normal to the velocity component
+     * and is reflected across the walls tangential to it, at the domain
+     * boundary as well as at obstacles.
+     *
+     * @param[in] velocity component
+     * @param[in] flux holding the explicit prediction, corrected in place
+     * @param[in] inner faces in x direction
+     * @param[in] inner faces in y direction
+     * @param[in] whether the velocity is normal to the walls in x direction
+     * @param[in] grid in which the calculations are done
+     *
+     */
+    void solve_viscous(const Matrix<double> &A, Matrix<double> &F, int imax, int jmax, bool normal_x, const Grid &grid);
+
+    /// pressure history ring buffer for warm starting the pressure solver
+    std::vector<Matrix<double>> _P_history;
+    /// time levels of the pressure history
+    std::vector<double> _t_history;
+    /// index of the most recent history level
+    int _history_head{-1};
+    /// number of valid history levels
+    int _history_count{0};
 };
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Datastructures.hpp"
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Bilinear interpolation of a staggered quantity at a point
+ *
+ * The point lies between the unknowns (i, j) and (i + 1, j + 1) of the
+ * quantity, with the weights wx and wy of the upper ones.
+ */
+struct Stencil {
+    int i;
+    int j;
+    double wx;
+    double wy;
+
+    /// Interpolated value of the quantity stored in the matrix
+    double apply(const Matrix<double> &M) const {
+        return (1.0 - wy) * ((1.0 - wx) * M(i, j) + wx * M(i + 1, j)) +
+               wy * ((1.0 - wx) * M(i, j + 1) + wx * M(i + 1, j + 1));
+    }
+};
+
+/**
+ * @brief Locations of the staggered unknowns of a grid
+ *
+ * The origin is the lower left corner of the domain, the walls lying midway
+ * between the ghost and the inner cell centres. Points outside of the
+ * unknowns of a quantity are clamped to its outermost unknowns.
+ */
+class StaggeredLocations {
+  public:
+    /**
+     * @brief Constructor from the cell widths
+     *
+     * @param[in] widths of all cells in x direction, including the ghost cells
+     * @param[in] widths of all cells in y direction, including the ghost cells
+     */
+    StaggeredLocations(const std::vector<double> &dx_cells, const std::vector<double> &dy_cells);
+
+    /// Locations of the unknowns of a grid
+    explicit StaggeredLocations(const Grid &grid);
+
+    /// Stencils of the x-velocity, the y-velocity and the pressure
+    Stencil u(double x, double y) const;
+    Stencil v(double x, double y) const;
+    Stencil p(double x, double y) const;
+
+    /// Locations of the faces 0 to imax and of the cell centres 0 to imax + 1
+    const std::vector<double> &x_faces() const { return _x_faces; }
+    const std::vector<double> &x_centres() const { return _x_centres; }
+    /// Locations of the faces 0 to jmax and of the cell centres 0 to jmax + 1
+    const std::vector<double> &y_faces() const { return _y_faces; }
+    const std::vector<double> &y_centres() const { return _y_centres; }
+
+  private:
+    std::vector<double> _x_faces;
+    std::vector<double> _x_centres;
+    std::vector<double> _y_faces;
+    std::vector<double> _y_centres;
+};
+
+/**
+ * @brief Velocities and pressure of a case together with its cell widths
+ *
+ * A flow state is taken from one grid and carried over to another one, e.g.
+ * from a coarse grid to the next finer one when bootstrapping a run, or from
+ * a state file written by an earlier run. The widths of all cells, ghost
+ * cells included, locate the staggered unknowns, so the grids may differ in
+ * resolution and stretching as long as they cover the same domain.
+ */
+struct FlowState {
+    /// Number of inner cells in x and y direction
+    int imax{0};
+    int jmax{0};
+    /// Widths of all cells, including the two ghost cells
+    std::vector<double> dx_cells;
+    std::vector<double> dy_cells;
+
+    Matrix<double> U;
+    Matrix<double> V;
+    Matrix<double> P;
+
+    /**
+     * @brief Copies the fields of a case, ghost cells included
+     *
+     * The boundary conditions should be applied before, so the ghost cells
+     * describe the walls.
+     *
+     * @param[in] fields of the case
+     * @param[in] grid of the case
+     */
+    static FlowState capture(Fields &field, const Grid &grid);
+
+    /**
+     * @brief Interpolates the state bilinearly onto the fields of a grid
+     *
+     * Every unknown is interpolated from the four nearest unknowns of the
+     * same kind, locations outside of the state being clamped to its
+     * outermost unknowns.
+     *
+     * @param[out] fields to be initialised
+     * @param[in] grid of the fields
+     */
+    void prolongate(Fields &field, const Grid &grid) const;
+
+    /**
+     * @brief Writes the state to a binary file
+     *
+     * @param[in] file name
+     * @param[out] whether the file could be written
+     */
+    bool write(const std::string &file_name) const;
+
+    /**
+     * @brief Reads a state written by write()
+     *
+     * @param[in] file name
+     * @param[out] state read from the file
+     * @param[out] whether the file could be read
+     */
+    static bool read(const std::string &file_name, FlowState &state);
+};
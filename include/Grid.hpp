@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -14,9 +17,25 @@
 /**
  * @brief Data structure holds cells and related sub-containers
  *
+ * The grid is divided into square tiles of tile_size cells. Only the tiles
+ * holding fluid cells or cells next to fluid, the active tiles, store their
+ * cells, so mostly solid geometries need cells for little more than their
+ * fluid. The kernels of the fields visit the active tiles only.
  */
 class Grid {
   public:
+    /// Rectangle of the cells imin to imax and jmin to jmax, ghost cells
+    /// included
+    struct Tile {
+        int imin;
+        int jmin;
+        int imax;
+        int jmax;
+    };
+
+    /// Edge length of the tiles in cells
+    static constexpr int tile_size = 32;
+
     Grid() = default;
 
     /**
@@ -31,9 +50,12 @@ class Grid {
      */
     Grid(std::string geom_name, Domain &domain);
 
-    /// index based cell access
+    /// index based cell access, cells of inactive tiles being solid
     Cell cell(int i, int j) const;
 
+    /// whether cell (i, j) is a fluid cell, false outside of the grid
+    bool is_fluid(int i, int j) const;
+
     /// access number of cells in x direction
     int imax() const;
     /// access number of cells in y direction
@@ -46,10 +68,20 @@ class Grid {
     /// access number of cells in x direction excluding ghost cells
     const Domain &domain() const;
 
-    /// access cell size in x-direction
+    /// access cell size in x-direction, the mean one on stretched grids
     double dx() const;
-    /// access cell size in y-direction
+    /// access cell size in y-direction, the mean one on stretched grids
     double dy() const;
+    /// access cell size of column i in x-direction
+    double dx(int i) const;
+    /// access cell size of row j in y-direction
+    double dy(int j) const;
+    /// access smallest cell size in x-direction
+    double dx_min() const;
+    /// access smallest cell size in y-direction
+    double dy_min() const;
+    /// whether all cells have the same size
+    bool uniform() const;
 
     /**
      * @brief Access inflow cells
@@ -72,6 +104,83 @@ class Grid {
      */
     const std::vector<Cell *> &fixed_wall_cells() const;
 
+    /// Tiles with fluid cells or cells next to fluid, row by row
+    const std::vector<Tile> &active_tiles() const;
+
+    /// Share of the tiles that are active
+    double active_fraction() const;
+
+    /**
+     * @brief Calls the kernel for the cells of the active tiles in a range
+     *
+     * The cells (i, j) with i0 <= i <= i1 and j0 <= j <= j1 are visited
+     * column by column within each tile, in one sweep over the range if all
+     * tiles are active.
+     *
+     * @param[in] first column
+     * @param[in] last column
+     * @param[in] first row
+     * @param[in] last row
+     * @param[in] kernel called with i and j
+     */
+    template <typename Kernel> void for_active_cells(int i0, int i1, int j0, int j1, Kernel &&kernel) const {
+        if (_active_tiles.size() == _tile_slot.size()) {
+            for (int i = i0; i < i1 + 1; ++i) {
+                for (int j = j0; j < j1 + 1; ++j) {
+                    kernel(i, j);
+                }
+            }
+            return;
+        }
+        for (const Tile &tile : _active_tiles) {
+            int imin = std::max(i0, tile.imin);
+            int imax = std::min(i1, tile.imax);
+            int jmin = std::max(j0, tile.jmin);
+            int jmax = std::min(j1, tile.jmax);
+            for (int i = imin; i < imax + 1; ++i) {
+                for (int j = jmin; j < jmax + 1; ++j) {
+                    kernel(i, j);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Calls the kernel for the row segments of the active tiles in a
+     * range
+     *
+     * Like for_active_cells, but the kernel gets a row j and its first and
+     * last column i0 and i1 within a tile, so it can sweep the contiguous
+     * elements of the row in one loop. If all tiles are active, the rows of
+     * the range are passed whole.
+     *
+     * @param[in] first column
+     * @param[in] last column
+     * @param[in] first row
+     * @param[in] last row
+     * @param[in] kernel called with j, i0 and i1
+     */
+    template <typename Kernel> void for_active_rows(int i0, int i1, int j0, int j1, Kernel &&kernel) const {
+        if (_active_tiles.size() == _tile_slot.size()) {
+            for (int j = j0; j < j1 + 1; ++j) {
+                kernel(j, i0, i1);
+            }
+            return;
+        }
+        for (const Tile &tile : _active_tiles) {
+            int imin = std::max(i0, tile.imin);
+            int imax = std::min(i1, tile.imax);
+            int jmin = std::max(j0, tile.jmin);
+            int jmax = std::min(j1, tile.jmax);
+            if (imin > imax) {
+                continue;
+            }
+            for (int j = jmin; j < jmax + 1; ++j) {
+                kernel(j, imin, imax);
+            }
+        }
+    }
+
   private:
     /**@brief Default lid driven cavity case generator
      *
@@ -80,12 +189,42 @@ class Grid {
      */
     void build_lid_driven_cavity();
 
-    /// Build cell data structures with given geometrical data
-    void assign_cell_types(std::vector<std::vector<int>> &geometry_data);
-    /// Extract geometry from pgm file and create geometrical data
-    void parse_geometry_file(std::string filedoc, std::vector<std::vector<int>> &geometry_data);
+    /**
+     * @brief Builds the cells of the subdomain from the geometry ids
+     *
+     * The geometry ids are read row by row in parallel and the active tiles
+     * are found from them. The cells of the active tiles are then
+     * classified row by row, counting the cells of each type per row. The
+     * cell containers are allocated once and filled in a last parallel pass,
+     * which also connects every cell to its neighbours and borders.
+     *
+     * @param[in] function filling the geometry ids of a global row, including
+     * the ghost cells
+     */
+    void build_cells(const std::function<void(int, std::vector<int> &)> &read_row);
 
-    Matrix<Cell> _cells;
+    /**
+     * @brief Extract geometry from a pgm file and build the cells
+     *
+     * Reads ASCII (P2) and binary (P5, 8 or 16 bit) files through a memory
+     * map, classifying every cell as soon as its value is scanned.
+     *
+     * @param[in] pgm file name
+     * @param[out] whether the file could be read
+     */
+    bool parse_geometry_file(std::string filedoc);
+
+    /// Position of cell (i, j) in _cells, -1 outside of the active tiles
+    int cell_index(int i, int j) const;
+    /// Cell (i, j) of the subdomain, null outside of the active tiles
+    Cell *cell_at(int i, int j);
+
+    /// Cells of the active tiles, tile after tile, row by row in a tile
+    std::vector<Cell> _cells;
+    /// Position of every tile among the active ones, -1 if inactive
+    std::vector<int> _tile_slot;
+    int _tiles_x{0};
+    std::vector<Tile> _active_tiles;
     std::vector<Cell *> _fluid_cells;
     std::vector<Cell *> _fixed_wall_cells;
     std::vector<Cell *> _moving_wall_cells;
@@ -95,3 +234,36 @@ class Grid {
     double _dx;
     double _dy;
 };
+
+/**
+ * @brief Shares immutable grids between cases of one process
+ *
+ * Cases with the same geometry file and cell sizes get the same Grid
+ * instance. The boundaries and solvers only read the grid, so one grid can
+ * serve any number of concurrently running cases.
+ */
+class GridCache {
+  public:
+    /**
+     * @brief Returns the grid of the geometry and domain, building it on
+     * the first request
+     *
+     * @param[in] geometry file name
+     * @param[in] domain with the cell sizes
+     */
+    std::shared_ptr<const Grid> get(const std::string &geom_name, Domain &domain);
+
+    /// number of distinct grids built so far
+    int size() const;
+
+  private:
+    struct Entry {
+        std::string geom_name;
+        std::vector<double> dx_cells;
+        std::vector<double> dy_cells;
+        std::shared_ptr<const Grid> grid;
+    };
+
+    mutable std::mutex _mutex;
+    std::vector<Entry> _entries;
+};
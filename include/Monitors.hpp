@@ -0,0 +1,116 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Cell.hpp"
+#include "Fields.hpp"
+#include "FlowState.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Time histories of probe points, lines and wall forces
+ *
+ * A probe records the velocities and the pressure at a point, a line the
+ * same at equally spaced points between two end points, interpolated
+ * bilinearly from the staggered unknowns. The stencils are located once, so
+ * a sample costs a few loads per point. A force monitor integrates the
+ * pressure and the viscous shear of the fluid on all faces of the walls with
+ * a wall id, giving drag (x) and lift (y) per unit depth.
+ *
+ * The samples are collected in memory and appended to the output files in
+ * chunks, one file per monitor, as CSV text or as raw doubles after a
+ * two-line text header.
+ */
+class Monitors {
+  public:
+    Monitors() = default;
+
+    /**
+     * @brief Adds a probe point
+     *
+     * @param[in] name of the monitor and its output file
+     * @param[in] x coordinate
+     * @param[in] y coordinate
+     */
+    void add_probe(const std::string &name, double x, double y);
+
+    /**
+     * @brief Adds a line of equally spaced points, end points included
+     *
+     * @param[in] name of the monitor and its output file
+     * @param[in] x coordinate of the first point
+     * @param[in] y coordinate of the first point
+     * @param[in] x coordinate of the last point
+     * @param[in] y coordinate of the last point
+     * @param[in] number of points
+     */
+    void add_line(const std::string &name, double x0, double y0, double x1, double y1, int points);
+
+    /**
+     * @brief Adds the force of the fluid on the walls of an id
+     *
+     * @param[in] name of the monitor and its output file
+     * @param[in] id of the walls, as in the geometry file
+     */
+    void add_forces(const std::string &name, int wall_id);
+
+    /// Whether no monitor is defined
+    bool empty() const;
+
+    /**
+     * @brief Locates the points, selects the wall cells and opens the files
+     *
+     * @param[in] grid of the case
+     * @param[in] path and case name the monitor names are appended to
+     * @param[in] whether the files are binary instead of CSV
+     * @param[in] number of samples kept in memory before they are written
+     */
+    void open(const Grid &grid, const std::string &prefix, bool binary, int buffer_size);
+
+    /**
+     * @brief Records all monitors
+     *
+     * The boundary conditions should be applied before, the interpolation
+     * near walls and the wall forces using the ghost cells.
+     *
+     * @param[in] fields of the case
+     * @param[in] grid of the case
+     * @param[in] time step
+     * @param[in] time
+     */
+    void sample(Fields &field, const Grid &grid, int timestep, double t);
+
+    /// Writes the buffered samples
+    void flush();
+
+  private:
+    struct Monitor {
+        std::string name;
+        /// Coordinates of the points of a probe or line
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<Stencil> u;
+        std::vector<Stencil> v;
+        std::vector<Stencil> p;
+        /// Walls of a force monitor, -1 for probes and lines
+        int wall_id{-1};
+        std::vector<const Cell *> walls;
+        /// Samples not written yet, one row of values after another
+        std::vector<double> buffer;
+        std::ofstream file;
+
+        /// Names of the values of a sample
+        std::vector<std::string> columns() const;
+    };
+
+    /// Force of the fluid on the walls of a monitor
+    void forces(const Monitor &monitor, Fields &field, const Grid &grid, double &fx, double &fy) const;
+
+    std::vector<Monitor> _monitors;
+    bool _binary{false};
+    /// Samples collected before the buffers are written
+    int _buffer_size{1024};
+    int _buffered{0};
+};
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Boundary.hpp"
+#include "CosineTransform.hpp"
 #include "Fields.hpp"
 #include "Grid.hpp"
+#include <ostream>
 #include <utility>
+#include <vector>
 /**
  * @brief Abstract class for pressure Poisson equation solver
  *
@@ -20,7 +23,12 @@ class PressureSolver {
      * @param[in] grid to be used
      * @param[in] boundary to be used
      */
-    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) = 0;
+    virtual double solve(Fields &field, const Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) = 0;
+
+    /**
+     * @brief Notify the solver that the iterations of a new time step begin
+     */
+    virtual void start_timestep() = 0;
 };
 
 /**
@@ -36,8 +44,10 @@ class SOR : public PressureSolver {
      * @brief Constructor of SOR solver
      *
      * @param[in] relaxation factor
+     * @param[in] whether the relaxation factor is adapted during the run
+     * @param[in] stream the adapted relaxation factors are written to
      */
-    SOR(double omega);
+    SOR(double omega, bool adaptive = false, std::ostream *out = nullptr);
 
     virtual ~SOR() = default;
 
@@ -48,8 +58,88 @@ class SOR : public PressureSolver {
      * @param[in] grid to be used
      * @param[in] boundary to be used
      */
-    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+    virtual double solve(Fields &field, const Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /**
+     * @brief Adapts the relaxation factor to the residual contraction
+     * observed in the previous time step, if enabled
+     *
+     * The asymptotic contraction rate lambda of SOR with the relaxation
+     * factor omega gives the spectral radius mu of the Jacobi iteration via
+     * (lambda + omega - 1)^2 = lambda omega^2 mu^2, from which the optimal
+     * relaxation factor 2 / (1 + sqrt(1 - mu^2)) follows.
+     */
+    virtual void start_timestep();
+
+    /// Current relaxation factor
+    double omega() const;
 
   private:
     double _omega;
+    /// Whether the relaxation factor is adapted
+    bool _adaptive{false};
+    /// Upper bound for the adapted relaxation factor. Obstacles can raise
+    /// the spectral radius above the one of the rectangle (long channels,
+    /// mazes), so only a generic bound is used.
+    double _omega_max{1.99};
+    /// Stream of the case the adapted relaxation factors are written to
+    std::ostream *_out{nullptr};
+    /// Residuals of the sweeps in the current time step
+    std::vector<double> _residuals;
+};
+
+/**
+ * @brief Direct solver for the pressure Poisson equation on rectangular
+ * domains without obstacles
+ *
+ * The discrete Laplacian with homogeneous Neumann conditions on all walls is
+ * diagonalized by cosine transforms in x and y direction, so the equation is
+ * solved exactly in O(N log N) by transforming the right hand side, dividing
+ * by the eigenvalues and transforming back. The transform plans and the
+ * eigenvalues are computed once for the grid and reused in every time step.
+ */
+class FastPoissonSolver : public PressureSolver {
+  public:
+    FastPoissonSolver() = default;
+
+    /**
+     * @brief Constructor of the fast Poisson solver
+     *
+     * @param[in] uniform grid to be solved on, which must not contain obstacles
+     */
+    FastPoissonSolver(const Grid &grid);
+
+    virtual ~FastPoissonSolver() = default;
+
+    /**
+     * @brief Solve the pressure equation on given field, grid and boundary
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     * @param[in] boundary to be used
+     */
+    virtual double solve(Fields &field, const Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /// Nothing to prepare, the solution is exact in every time step
+    virtual void start_timestep();
+
+    /**
+     * @brief Whether the grid can be solved with this solver, i.e. the grid
+     * is uniform and all inner cells are fluid cells
+     *
+     * @param[in] grid to be checked
+     */
+    static bool applicable(const Grid &grid);
+
+  private:
+    /// Cosine transform plan in x direction
+    CosineTransform _transform_x;
+    /// Cosine transform plan in y direction
+    CosineTransform _transform_y;
+    /// Eigenvalues of the second difference operator in x direction
+    std::vector<double> _lambda_x;
+    /// Eigenvalues of the second difference operator in y direction
+    std::vector<double> _lambda_y;
+    /// Work array for the inner cells
+    std::vector<double> _work;
 };
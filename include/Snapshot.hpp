@@ -0,0 +1,108 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "FlowState.hpp"
+
+/**
+ * @brief Compressed snapshots of the flow and their conversion to VTK
+ *
+ * A snapshot holds the velocities and the pressure of all cells, ghost cells
+ * included, so the VTK output can be reconstructed exactly as output_vtk
+ * writes it. Every quantity is compressed separately:
+ *
+ * - lossless: the bit patterns of the values, XOR-ed with the ones of the
+ *   previous snapshot if delta encoded, are shuffled into byte planes (all
+ *   first bytes, then all second bytes, ...) and deflated. Smooth fields
+ *   share sign, exponent and leading mantissa bytes, which become long runs.
+ * - lossy: the values are quantized to integers q = round(x / (2 tolerance)),
+ *   so that no value differs by more than the tolerance. With delta encoding
+ *   the quantized values of the previous snapshot are subtracted. What
+ *   remains is predicted from the left, lower and lower left neighbours
+ *   (Lorenzo predictor), and the residuals are written as zigzag varints and
+ *   deflated. Quantities whose values are too large for the tolerance, or
+ *   not finite, fall back to the lossless coding.
+ *
+ * Delta encoded snapshots refer to the previous snapshot; every
+ * keyframe_interval-th snapshot is stored on its own, so a snapshot is
+ * decoded from at most keyframe_interval files. The codec keeps the
+ * reconstructed previous snapshot, writer and reader thus predicting from the
+ * same values.
+ */
+class SnapshotCodec {
+  public:
+    SnapshotCodec() = default;
+
+    /**
+     * @brief Constructor of a writer
+     *
+     * @param[in] whether the values are quantized
+     * @param[in] largest absolute error of the lossy mode
+     * @param[in] snapshots from one keyframe to the next, 1 disabling the
+     * delta encoding
+     */
+    SnapshotCodec(bool lossy, double tolerance, int keyframe_interval);
+
+    /**
+     * @brief Compresses a snapshot into a file
+     *
+     * @param[in] name of the file
+     * @param[in] velocities and pressure with the cell widths
+     * @param[in] time step of the snapshot
+     * @param[in] time of the snapshot
+     */
+    bool write(const std::string &file_name, const FlowState &state, int timestep, double t);
+
+    /**
+     * @brief Decompresses a snapshot
+     *
+     * Delta encoded snapshots need the snapshot they refer to to be read
+     * before by the same codec.
+     *
+     * @param[in] name of the file
+     * @param[out] velocities and pressure with the cell widths
+     * @param[out] time step of the snapshot
+     * @param[out] time of the snapshot
+     */
+    bool read(const std::string &file_name, FlowState &state, int &timestep, double &t);
+
+    /**
+     * @brief Writes a snapshot like the solution files of a case
+     *
+     * Pressure as cell data and velocity interpolated to the cell corners as
+     * point data, in legacy VTK format.
+     *
+     * @param[in] velocities and pressure with the cell widths
+     * @param[in] name of the VTK file
+     */
+    static void write_vtk(const FlowState &state, const std::string &file_name);
+
+    /**
+     * @brief Converts snapshot files to VTK files of the same names
+     *
+     * The files are read in the order of their time steps, so delta encoded
+     * ones find the snapshot they refer to.
+     *
+     * @param[in] names of the snapshot files
+     * @param[out] number of the files that could not be converted
+     */
+    static int convert(std::vector<std::string> file_names);
+
+  private:
+    /// Encodes one quantity of nx values per row, appending it to the
+    /// buffer and replacing the values by the reconstructed ones
+    void encode(std::vector<double> &values, const std::vector<double> *previous, int nx, std::string &buffer) const;
+    /// Decodes one quantity of nx values per row from the file
+    bool decode(std::istream &file, const std::vector<double> *previous, int nx, std::vector<double> &values) const;
+
+    bool _lossy{false};
+    double _tolerance{1e-6};
+    int _keyframe_interval{10};
+    /// Snapshots written since the last keyframe
+    int _since_keyframe{0};
+    /// Reconstructed values of the previous snapshot, U, V and P
+    std::vector<double> _previous[3];
+    int _previous_step{-1};
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Running statistics of the flow in the cell centres
+ *
+ * Mean, variance, minimum and maximum of the velocities and the pressure are
+ * accumulated with Welford's algorithm, every time step weighted with its
+ * timestep size, so the statistics are time averages even for varying
+ * timesteps. Optionally the covariance of the velocities is accumulated as
+ * well, which completes the Reynolds stresses u'u', v'v' and u'v'.
+ *
+ * The accumulators are stored row by row as plain arrays and updated in one
+ * pass per row, which the compiler vectorises.
+ */
+class Statistics {
+  public:
+    /// Accumulated quantities
+    enum Quantity { U, V, P };
+
+    Statistics() = default;
+
+    /**
+     * @brief Constructor of empty accumulators
+     *
+     * @param[in] number of cells in x direction
+     * @param[in] number of cells in y direction
+     * @param[in] whether the covariance of the velocities is accumulated
+     */
+    Statistics(int imax, int jmax, bool stresses);
+
+    /**
+     * @brief Adds the current fields, velocities interpolated to the centres
+     *
+     * @param[in] fields of the case
+     * @param[in] grid of the case
+     * @param[in] weight of the sample, the timestep size
+     */
+    void accumulate(Fields &field, const Grid &grid, double weight);
+
+    /// Number of accumulated time steps
+    int samples() const;
+    /// Accumulated time
+    double time() const;
+    /// Whether the covariance of the velocities is accumulated
+    bool stresses() const;
+
+    /// Statistics of the inner cell (i, j), starting at 1
+    double mean(Quantity q, int i, int j) const;
+    double variance(Quantity q, int i, int j) const;
+    double rms(Quantity q, int i, int j) const;
+    double min(Quantity q, int i, int j) const;
+    double max(Quantity q, int i, int j) const;
+    /// Covariance u'v' of the velocities, zero if not accumulated
+    double covariance(int i, int j) const;
+
+  private:
+    /// Accumulators of one quantity
+    struct Moments {
+        std::vector<double> mean;
+        std::vector<double> m2;
+        std::vector<double> min;
+        std::vector<double> max;
+    };
+
+    int index(int i, int j) const { return (i - 1) + _imax * (j - 1); }
+
+    int _imax{0};
+    int _jmax{0};
+    bool _stresses{false};
+    int _samples{0};
+    double _weight{0.0};
+    Moments _moments[3];
+    /// Co-moment of u and v
+    std::vector<double> _cuv;
+    /// Values of the current row in the cell centres
+    std::vector<double> _row[3];
+};
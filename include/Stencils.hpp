@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "Datastructures.hpp"
+#include "Enums.hpp"
+
+/**
+ * @brief Factors of the momentum stencils, computed once per grid
+ *
+ * The scalar factors hold for grids of constant cell widths, the arrays for
+ * stretched ones, indexed like the cell widths (cells) and the distances of
+ * the cell centres (faces between cell i and i + 1).
+ */
+struct StencilCoefficients {
+    /// upwinding coefficient
+    double gamma{0.0};
+
+    /// 1 / dx, 1 / dy of constant cell widths
+    double inv_dx{0.0};
+    double inv_dy{0.0};
+    /// 1 / dx^2, 1 / dy^2 of constant cell widths
+    double inv_dx2{0.0};
+    double inv_dy2{0.0};
+
+    /// 1 / dx and 1 / dy of every cell
+    std::vector<double> inv_dx_cells;
+    std::vector<double> inv_dy_cells;
+    /// 1 / distance of the centres of cell i and i + 1
+    std::vector<double> inv_dx_centres;
+    std::vector<double> inv_dy_centres;
+    /// Weights of cell i and i + 1 interpolating to the face in between
+    std::vector<double> x_weight_low;
+    std::vector<double> x_weight_high;
+    std::vector<double> y_weight_low;
+    std::vector<double> y_weight_high;
+};
+
+/**
+ * @brief Convection and diffusion of the velocities for one scheme and
+ * spacing
+ *
+ * Fixing both at compile time lets the compiler drop the upwind terms of
+ * central differences, fold the upwinding coefficient of the donor cell
+ * scheme and use scalar factors instead of the per cell ones on uniform
+ * grids. Discretization holds the factors of its grid and the pressure
+ * stencils.
+ */
+template <convection_scheme S, grid_spacing G>
+struct MomentumStencil {
+    static constexpr bool uniform = (G == grid_spacing::UNIFORM);
+
+    /// 1 / width of cell i in x direction
+    static double inv_dx(const StencilCoefficients &c, int i) { return uniform ? c.inv_dx : c.inv_dx_cells[i]; }
+    /// 1 / width of cell j in y direction
+    static double inv_dy(const StencilCoefficients &c, int j) { return uniform ? c.inv_dy : c.inv_dy_cells[j]; }
+    /// 1 / distance of the centres of cells i and i + 1
+    static double inv_dxc(const StencilCoefficients &c, int i) { return uniform ? c.inv_dx : c.inv_dx_centres[i]; }
+    /// 1 / distance of the centres of cells j and j + 1
+    static double inv_dyc(const StencilCoefficients &c, int j) { return uniform ? c.inv_dy : c.inv_dy_centres[j]; }
+
+    /// Upwinding coefficient, a constant unless the scheme is a blend
+    static double gamma(const StencilCoefficients &c) {
+        return (S == convection_scheme::UPWIND) ? 1.0 : (S == convection_scheme::CENTRAL) ? 0.0 : c.gamma;
+    }
+
+    /// V(i, j) and V(i + 1, j) interpolated to the face in between
+    template <typename T>
+    static T mid_x(const StencilCoefficients &c, const Matrix<T> &V, int i, int j) {
+        if constexpr (uniform) {
+            return 0.5 * (V(i, j) + V(i + 1, j));
+        } else {
+            return c.x_weight_low[i] * V(i, j) + c.x_weight_high[i] * V(i + 1, j);
+        }
+    }
+
+    /// U(i, j) and U(i, j + 1) interpolated to the face in between
+    template <typename T>
+    static T mid_y(const StencilCoefficients &c, const Matrix<T> &U, int i, int j) {
+        if constexpr (uniform) {
+            return 0.5 * (U(i, j) + U(i, j + 1));
+        } else {
+            return c.y_weight_low[j] * U(i, j) + c.y_weight_high[j] * U(i, j + 1);
+        }
+    }
+
+    /// Convection of the x-velocity by the donor-cell scheme. The control volume of U(i, j) reaches from the
+    /// centre of cell i to the centre of cell i + 1, the values at its top and bottom faces are interpolated.
+    template <typename T>
+    static T convection_u(const StencilCoefficients &c, const Matrix<T> &U, const Matrix<T> &V, int i, int j) {
+        using std::fabs;
+        const double idx = inv_dxc(c, i);
+        const double idy = inv_dy(c, j);
+        T right = U(i, j) + U(i + 1, j);
+        T left = U(i - 1, j) + U(i, j);
+        T v_top = mid_x(c, V, i, j);
+        T v_bottom = mid_x(c, V, i, j - 1);
+        T u_top = mid_y(c, U, i, j);
+        T u_bottom = mid_y(c, U, i, j - 1);
+
+        T result = (0.25 * idx) * (right * right - left * left) + idy * (v_top * u_top - v_bottom * u_bottom);
+        if constexpr (S != convection_scheme::CENTRAL) {
+            const double g = gamma(c);
+            result = result +
+                     (0.25 * g * idx) * (fabs(right) * (U(i, j) - U(i + 1, j)) - fabs(left) * (U(i - 1, j) - U(i, j))) +
+                     (0.5 * g * idy) * (fabs(v_top) * (U(i, j) - U(i, j + 1)) -
+                                        fabs(v_bottom) * (U(i, j - 1) - U(i, j)));
+        }
+        return result;
+    }
+
+    /// Convection of the y-velocity by the donor-cell scheme, on the control volume from the centre of cell j to
+    /// the centre of cell j + 1
+    template <typename T>
+    static T convection_v(const StencilCoefficients &c, const Matrix<T> &U, const Matrix<T> &V, int i, int j) {
+        using std::fabs;
+        const double idx = inv_dx(c, i);
+        const double idy = inv_dyc(c, j);
+        T top = V(i, j) + V(i, j + 1);
+        T bottom = V(i, j - 1) + V(i, j);
+        T u_right = mid_y(c, U, i, j);
+        T u_left = mid_y(c, U, i - 1, j);
+        T v_right = mid_x(c, V, i, j);
+        T v_left = mid_x(c, V, i - 1, j);
+
+        T result = (0.25 * idy) * (top * top - bottom * bottom) + idx * (u_right * v_right - u_left * v_left);
+        if constexpr (S != convection_scheme::CENTRAL) {
+            const double g = gamma(c);
+            result = result +
+                     (0.25 * g * idy) * (fabs(top) * (V(i, j) - V(i, j + 1)) - fabs(bottom) * (V(i, j - 1) - V(i, j))) +
+                     (0.5 * g * idx) * (fabs(u_right) * (V(i, j) - V(i + 1, j)) -
+                                        fabs(u_left) * (V(i - 1, j) - V(i, j)));
+        }
+        return result;
+    }
+
+    /// Diffusion of the x-velocity by central differences, located at the faces in x and at the centres in y
+    template <typename T>
+    static T diffusion_u(const StencilCoefficients &c, const Matrix<T> &U, int i, int j) {
+        if constexpr (uniform) {
+            return c.inv_dx2 * (U(i + 1, j) - 2.0 * U(i, j) + U(i - 1, j)) +
+                   c.inv_dy2 * (U(i, j + 1) - 2.0 * U(i, j) + U(i, j - 1));
+        } else {
+            return c.inv_dx_centres[i] * (c.inv_dx_cells[i + 1] * (U(i + 1, j) - U(i, j)) -
+                                          c.inv_dx_cells[i] * (U(i, j) - U(i - 1, j))) +
+                   c.inv_dy_cells[j] * (c.inv_dy_centres[j] * (U(i, j + 1) - U(i, j)) -
+                                        c.inv_dy_centres[j - 1] * (U(i, j) - U(i, j - 1)));
+        }
+    }
+
+    /// Diffusion of the y-velocity by central differences, located at the centres in x and at the faces in y
+    template <typename T>
+    static T diffusion_v(const StencilCoefficients &c, const Matrix<T> &V, int i, int j) {
+        if constexpr (uniform) {
+            return c.inv_dx2 * (V(i + 1, j) - 2.0 * V(i, j) + V(i - 1, j)) +
+                   c.inv_dy2 * (V(i, j + 1) - 2.0 * V(i, j) + V(i, j - 1));
+        } else {
+            return c.inv_dx_cells[i] * (c.inv_dx_centres[i] * (V(i + 1, j) - V(i, j)) -
+                                        c.inv_dx_centres[i - 1] * (V(i, j) - V(i - 1, j))) +
+                   c.inv_dy_centres[j] * (c.inv_dy_cells[j + 1] * (V(i, j + 1) - V(i, j)) -
+                                          c.inv_dy_cells[j] * (V(i, j) - V(i, j - 1)));
+        }
+    }
+};
@@ -0,0 +1,148 @@
+/*
+In this file, we map the block of the field arrays, hand out pieces of it and
+report on which NUMA nodes and pages they are placed.
+*/
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+const std::size_t page_size = 4096;
+const std::size_t huge_page_size = 2 * 1024 * 1024;
+
+std::size_t round_up(std::size_t bytes, std::size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+// Transparent huge pages need 2 MB aligned memory, so the block is mapped
+// with one huge page to spare and trimmed to the aligned part.
+
+Arena::Arena(std::size_t bytes, Pages pages) : _pages(pages) {
+    _size = round_up(std::max<std::size_t>(bytes, 1), (pages == Pages::normal) ? page_size : huge_page_size);
+    void *block = MAP_FAILED;
+    if (pages == Pages::huge) {
+        block = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block == MAP_FAILED) {
+            std::cerr << "No explicit huge pages available for the fields, using normal pages" << std::endl;
+            _pages = Pages::normal;
+        }
+    }
+    if (_pages == Pages::transparent) {
+        std::size_t mapped = _size + huge_page_size;
+        char *raw = static_cast<char *>(
+            mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw != MAP_FAILED) {
+            char *aligned = reinterpret_cast<char *>(round_up(reinterpret_cast<std::size_t>(raw), huge_page_size));
+            if (aligned > raw) {
+                munmap(raw, aligned - raw);
+            }
+            munmap(aligned + _size, raw + mapped - (aligned + _size));
+            madvise(aligned, _size, MADV_HUGEPAGE);
+            block = aligned;
+        }
+    }
+    if (block == MAP_FAILED) {
+        block = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (block == MAP_FAILED) {
+        std::cerr << "The memory of the fields could not be mapped" << std::endl;
+        _size = 0;
+        return;
+    }
+    _base = static_cast<char *>(block);
+}
+
+Arena::~Arena() {
+    if (_base != nullptr) {
+        munmap(_base, _size);
+    }
+}
+
+std::size_t Arena::piece_size(std::size_t bytes) { return round_up(bytes, page_size); }
+
+void *Arena::allocate(std::size_t bytes) {
+    std::size_t piece = piece_size(bytes);
+    if (_base == nullptr || _used + piece > _size) {
+        return nullptr;
+    }
+    void *memory = _base + _used;
+    _used += piece;
+    return memory;
+}
+
+bool Arena::owns(const void *memory) const {
+    const char *p = static_cast<const char *>(memory);
+    return _base != nullptr && p >= _base && p < _base + _size;
+}
+
+Arena::Pages Arena::pages(const std::string &name) {
+    if (name == "transparent") {
+        return Pages::transparent;
+    }
+    if (name == "explicit") {
+        return Pages::huge;
+    }
+    if (name != "none") {
+        std::cerr << "Unknown huge pages " << name << ", using none" << std::endl;
+    }
+    return Pages::normal;
+}
+
+// move_pages without target nodes only queries the node of every page; pages
+// not touched yet are reported with -ENOENT. The huge pages of the mapping
+// are listed in /proc/self/smaps.
+
+void Arena::report(std::ostream &out) const {
+    std::size_t count = _used / page_size;
+    std::vector<void *> addresses(count);
+    std::vector<int> status(count, 0);
+    for (std::size_t k = 0; k < count; ++k) {
+        addresses[k] = _base + k * page_size;
+    }
+    std::map<int, std::size_t> nodes;
+    if (count > 0 &&
+        syscall(SYS_move_pages, 0, count, addresses.data(), nullptr, status.data(), 0) == 0) {
+        for (int node : status) {
+            nodes[node]++;
+        }
+    }
+
+    std::size_t huge_kb = 0;
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+    while (std::getline(smaps, line)) {
+        std::size_t start;
+        char dash;
+        std::istringstream fields(line);
+        if (line.find('-') != std::string::npos && (fields >> std::hex >> start >> dash) && dash == '-') {
+            inside = (reinterpret_cast<char *>(start) == _base);
+        } else if (inside && (line.rfind("AnonHugePages:", 0) == 0 || line.rfind("Private_Hugetlb:", 0) == 0)) {
+            std::string name;
+            std::size_t kb;
+            std::istringstream(line) >> name >> kb;
+            huge_kb += kb;
+        }
+    }
+
+    const char *names[] = {"normal", "transparent huge", "explicit huge"};
+    out << "Field arena: " << _used / 1024 << " KB of " << _size / 1024 << " KB used, "
+        << names[static_cast<int>(_pages)] << " pages, " << huge_kb << " KB in huge pages\n";
+    for (const auto &node : nodes) {
+        if (node.first >= 0) {
+            out << "  NUMA node " << node.first << ": " << node.second << " pages\n";
+        } else {
+            out << "  not placed: " << node.second << " pages\n";
+        }
+    }
+}
@@ -0,0 +1,355 @@
+/*
+In this file, we advance a batch of cases on the same grid together, the
+values of all cases at a grid location being stored next to each other.
+*/
+#include "BatchedCase.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <utility>
+
+#include "Expressions.hpp"
+#include "Stencils.hpp"
+
+bool BatchedCase::compatible(const Case &first, const Case &other) {
+    return first._batchable && other._batchable && first._grid == other._grid &&
+           first._field.discretization().gamma() == other._field.discretization().gamma();
+}
+
+BatchedCase::BatchedCase(std::vector<std::unique_ptr<Case>> cases)
+    : _cases(std::move(cases)),
+      _grid(_cases.front()->_grid),
+      _discretization(&_cases.front()->_field.discretization()) {
+    int imax = _grid->imaxb();
+    int jmax = _grid->jmaxb();
+    _U = Matrix<Lanes>(imax, jmax, 0.0);
+    _V = Matrix<Lanes>(imax, jmax, 0.0);
+    _P = Matrix<Lanes>(imax, jmax, 0.0);
+    _F = Matrix<Lanes>(imax, jmax, 0.0);
+    _G = Matrix<Lanes>(imax, jmax, 0.0);
+    _RS = Matrix<Lanes>(imax, jmax, 0.0);
+
+    // Flux kernels by scheme (central, hybrid, upwind) and spacing (uniform,
+    // stretched), as in Fields::set_discretization
+    using kernel = void (BatchedCase::*)();
+    constexpr auto central = convection_scheme::CENTRAL;
+    constexpr auto hybrid = convection_scheme::HYBRID;
+    constexpr auto upwind = convection_scheme::UPWIND;
+    constexpr auto uniform = grid_spacing::UNIFORM;
+    constexpr auto stretched = grid_spacing::STRETCHED;
+    const kernel kernels[3][2] = {
+        {&BatchedCase::momentum_fluxes<central, uniform>, &BatchedCase::momentum_fluxes<central, stretched>},
+        {&BatchedCase::momentum_fluxes<hybrid, uniform>, &BatchedCase::momentum_fluxes<hybrid, stretched>},
+        {&BatchedCase::momentum_fluxes<upwind, uniform>, &BatchedCase::momentum_fluxes<upwind, stretched>}};
+    _momentum_fluxes = kernels[static_cast<int>(_discretization->scheme())]
+                              [static_cast<int>(_discretization->spacing())];
+
+    // Unused lanes repeat the last case, they are never running
+    int size = _cases.size();
+    for (int k = 0; k < batch_width; ++k) {
+        Case &member = *_cases[std::min(k, size - 1)];
+        _nu.m[k] = member._field.nu();
+        _tau.m[k] = member._field.tau();
+        _omega.m[k] = member._omg;
+        _wall_velocity.m[k] = member._wall_velocity;
+        _dt.m[k] = 0.0;
+        _running[k] = false;
+        _sweep[k] = false;
+        for (int j = 0; j < jmax; ++j) {
+            for (int i = 0; i < imax; ++i) {
+                _U(i, j).m[k] = member._field.u(i, j);
+                _V(i, j).m[k] = member._field.v(i, j);
+                _P(i, j).m[k] = member._field.p(i, j);
+            }
+        }
+    }
+}
+
+void BatchedCase::simulate() {
+    int size = _cases.size();
+    std::vector<double> t(size, 0.0);
+    std::vector<double> output_counter(size);
+    std::vector<int> timestep(size, 0);
+    std::vector<int> total_iter(size, 1);
+    std::vector<std::ofstream> logfiles(size);
+    for (int k = 0; k < size; ++k) {
+        output_counter[k] = _cases[k]->_output_freq;
+        logfiles[k].open(_cases[k]->_dict_name + "/log.txt");
+        _running[k] = t[k] <= _cases[k]->_t_end;
+    }
+
+    std::vector<int> iter(size);
+    std::vector<double> res(size);
+    std::vector<char> done(size);
+    while (std::any_of(_running, _running + size, [](bool running) { return running; })) {
+        apply_boundaries();
+        calculate_dt();
+        calculate_fluxes();
+        calculate_rs();
+
+        // Sweeping until the pressure of every running case has converged
+        // or reached its iteration limit
+        for (int k = 0; k < size; ++k) {
+            iter[k] = 0;
+            res[k] = std::numeric_limits<double>::max();
+            done[k] = not _running[k];
+        }
+        while (true) {
+            bool any = false;
+            for (int k = 0; k < size; ++k) {
+                if (not done[k] && not(res[k] > _cases[k]->_tolerance)) {
+                    done[k] = true;
+                }
+                if (not done[k] && iter[k] >= _cases[k]->_max_iter) {
+                    *_cases[k]->_out << "Pressure poisson solver did not converge to the given "
+                                        "tolerance...\n";
+                    done[k] = true;
+                }
+                _sweep[k] = not done[k];
+                any = any || _sweep[k];
+            }
+            if (not any) {
+                break;
+            }
+
+            sor_sweep();
+            apply_pressure_boundaries();
+            Lanes residual = calculate_residual();
+            for (int k = 0; k < size; ++k) {
+                if (_sweep[k]) {
+                    res[k] = residual.m[k];
+                    iter[k]++;
+                    total_iter[k]++;
+                    logfiles[k] << "Residual: " << res[k] << " Iteration:" << total_iter[k] << '\n';
+                }
+            }
+        }
+
+        calculate_velocities();
+
+        for (int k = 0; k < size; ++k) {
+            if (not _running[k]) {
+                continue;
+            }
+            Case &member = *_cases[k];
+            t[k] += _dt.m[k];
+            timestep[k]++;
+
+            *member._out << "Timestep size: " << std::setw(10) << _dt.m[k] << " | "
+                         << "Time: " << std::setw(8) << t[k] << std::setw(3) << " | "
+                         << "Residual: " << std::setw(11) << res[k] << std::setw(3) << " | "
+                         << "Pressure Poisson Iterations: " << std::setw(3) << iter[k] << '\n';
+            if (t[k] >= member._output_freq) {
+                store(k);
+                member.output(timestep[k], t[k]);
+                member._output_freq = member._output_freq + output_counter[k];
+            }
+            _running[k] = t[k] <= member._t_end;
+        }
+    }
+}
+
+// Same conditions as MovingWallBoundary and FixedWallBoundary, the moving
+// walls being applied first as in Case
+
+void BatchedCase::apply_boundaries() {
+    for (auto cell : _grid->moving_wall_cells()) {
+        int i = cell->i();
+        int j = cell->j();
+        if (cell->is_border(border_position::BOTTOM)) {
+            _U(i, j) = 2.0 * _wall_velocity - _U(i, j - 1);
+            _V(i, j - 1) = 0.0;
+            _P(i, j) = _P(i, j - 1);
+            _G(i, j - 1) = _V(i, j - 1);
+        } else if (cell->is_border(border_position::TOP)) {
+            _U(i, j) = 2.0 * _wall_velocity - _U(i, j + 1);
+            _V(i, j - 1) = 0.0;
+            _P(i, j) = _P(i, j + 1);
+            _G(i, j) = _V(i, j);
+        } else if (cell->is_border(border_position::RIGHT)) {
+            _U(i, j) = 0.0;
+            _V(i, j) = 2.0 * _wall_velocity - _V(i + 1, j);
+            _P(i, j) = _P(i, j - 1);
+            _F(i, j) = _U(i, j);
+        } else if (cell->is_border(border_position::LEFT)) {
+            _U(i, j) = 0.0;
+            _V(i, j) = 2.0 * _wall_velocity - _V(i - 1, j);
+            _P(i, j) = _P(i, j - 1);
+            _F(i, j) = _U(i, j);
+        }
+    }
+
+    for (auto cell : _grid->fixed_wall_cells()) {
+        int i = cell->i();
+        int j = cell->j();
+        if (cell->is_border(border_position::TOP)) {
+            _U(i, j) = -_U(i, j + 1);
+            _V(i, j) = 0.0;
+            _P(i, j) = _P(i, j + 1);
+            _G(i, j) = _V(i, j);
+        } else if (cell->is_border(border_position::RIGHT)) {
+            _U(i, j) = 0.0;
+            _V(i, j) = -_V(i + 1, j);
+            _P(i, j) = _P(i + 1, j);
+            _F(i, j) = _U(i, j);
+        } else if (cell->is_border(border_position::LEFT)) {
+            _U(i - 1, j) = 0.0;
+            _V(i, j) = -_V(i - 1, j);
+            _P(i, j) = _P(i - 1, j);
+            _F(i - 1, j) = _U(i - 1, j);
+        } else if (cell->is_border(border_position::BOTTOM)) {
+            _U(i, j) = -_U(i, j - 1);
+            _V(i, j) = 0.0;
+            _P(i, j) = _P(i, j - 1);
+            _G(i, j) = _V(i, j);
+        }
+    }
+}
+
+// Pressure ghost values only, as between the sweeps of SOR
+
+void BatchedCase::apply_pressure_boundaries() {
+    for (auto cell : _grid->moving_wall_cells()) {
+        int i = cell->i();
+        int j = cell->j();
+        if (cell->is_border(border_position::BOTTOM)) {
+            _P(i, j) = _P(i, j - 1);
+        } else if (cell->is_border(border_position::TOP)) {
+            _P(i, j) = _P(i, j + 1);
+        } else if (cell->is_border(border_position::RIGHT) || cell->is_border(border_position::LEFT)) {
+            _P(i, j) = _P(i, j - 1);
+        }
+    }
+
+    for (auto cell : _grid->fixed_wall_cells()) {
+        int i = cell->i();
+        int j = cell->j();
+        if (cell->is_border(border_position::TOP)) {
+            _P(i, j) = _P(i, j + 1);
+        } else if (cell->is_border(border_position::RIGHT)) {
+            _P(i, j) = _P(i + 1, j);
+        } else if (cell->is_border(border_position::LEFT)) {
+            _P(i, j) = _P(i - 1, j);
+        } else if (cell->is_border(border_position::BOTTOM)) {
+            _P(i, j) = _P(i, j - 1);
+        }
+    }
+}
+
+void BatchedCase::calculate_dt() {
+    Lanes u_max(0.0);
+    Lanes v_max(0.0);
+    for (auto cell : _grid->fluid_cells()) {
+        const Lanes &u = _U(cell->i(), cell->j());
+        const Lanes &v = _V(cell->i(), cell->j());
+        for (int k = 0; k < batch_width; ++k) {
+            u_max.m[k] = std::max(u_max.m[k], std::fabs(u.m[k]));
+            v_max.m[k] = std::max(v_max.m[k], std::fabs(v.m[k]));
+        }
+    }
+
+    double dx2 = _grid->dx_min() * _grid->dx_min();
+    double dy2 = _grid->dy_min() * _grid->dy_min();
+    for (int k = 0; k < batch_width; ++k) {
+        double CFLu = _grid->dx_min() / u_max.m[k];
+        double CFLv = _grid->dy_min() / v_max.m[k];
+        double CFLnu = (0.5 / _nu.m[k]) * (1.0 / (1.0 / dx2 + 1.0 / dy2));
+        _dt.m[k] = _running[k] ? _tau.m[k] * (std::min({CFLnu, CFLu, CFLv})) : 0.0;
+    }
+}
+
+void BatchedCase::calculate_fluxes() { (this->*_momentum_fluxes)(); }
+
+// Explicit Euler steps of Fields::momentum_fluxes with the same stencils and
+// the same order of operations, so every lane computes what the case does
+// on its own
+
+template <convection_scheme S, grid_spacing G> void BatchedCase::momentum_fluxes() {
+    using Stencil = MomentumStencil<S, G>;
+    const StencilCoefficients &c = _discretization->coefficients();
+
+    _grid->for_active_cells(1, _grid->imax() - 1, 1, _grid->jmax(), [&](int i, int j) {
+        Lanes N = -Stencil::convection_u(c, _U, _V, i, j);
+        Lanes D = _nu * Stencil::diffusion_u(c, _U, i, j);
+        _F(i, j) = _U(i, j) + _dt * (D + N);
+    });
+
+    _grid->for_active_cells(1, _grid->imax(), 1, _grid->jmax() - 1, [&](int i, int j) {
+        Lanes N = -Stencil::convection_v(c, _U, _V, i, j);
+        Lanes D = _nu * Stencil::diffusion_v(c, _V, i, j);
+        _G(i, j) = _V(i, j) + _dt * (D + N);
+    });
+}
+
+// Right hand side and projection with the expressions of Fields, evaluated
+// for all lanes
+
+void BatchedCase::calculate_rs() {
+    using namespace expr;
+    const std::vector<double> &dx = _grid->domain().dx_cells;
+    const std::vector<double> &dy = _grid->domain().dy_cells;
+    auto rs = ((at(_F) - at(_F, -1, 0)) / along_x(dx) + (at(_G) - at(_G, 0, -1)) / along_y(dy)) / _dt;
+    _grid->for_active_rows(1, _grid->imax(), 1, _grid->jmax(), [&](int j, int i0, int i1) {
+        assign_row(_RS, j, i0, i1, rs);
+        // Stopped cases have a zero timestep, their right hand side is zero
+        for (int i = i0; i < i1 + 1; ++i) {
+            Lanes &target = _RS(i, j);
+            for (int k = 0; k < batch_width; ++k) {
+                target.m[k] = _running[k] ? target.m[k] : 0.0;
+            }
+        }
+    });
+}
+
+void BatchedCase::calculate_velocities() {
+    using namespace expr;
+    const std::vector<double> &dx = _grid->domain().dx_cells;
+    const std::vector<double> &dy = _grid->domain().dy_cells;
+    auto u_new = at(_F) - _dt * (at(_P, 1, 0) - at(_P)) / (0.5 * (along_x(dx) + along_x(dx, 1)));
+    auto v_new = at(_G) - _dt * (at(_P, 0, 1) - at(_P)) / (0.5 * (along_y(dy) + along_y(dy, 1)));
+    _grid->for_active_rows(1, _grid->imax() - 1, 1, _grid->jmax(),
+                           [&](int j, int i0, int i1) { assign_row(_U, j, i0, i1, u_new); });
+    _grid->for_active_rows(1, _grid->imax(), 1, _grid->jmax() - 1,
+                           [&](int j, int i0, int i1) { assign_row(_V, j, i0, i1, v_new); });
+}
+
+void BatchedCase::sor_sweep() {
+    for (auto cell : _grid->fluid_cells()) {
+        int i = cell->i();
+        int j = cell->j();
+        Lanes coeff = _omega / _discretization->laplacian_diagonal(i, j);
+        Lanes p = (1.0 - _omega) * _P(i, j) + coeff * (_discretization->sor_helper(_P, i, j) - _RS(i, j));
+        Lanes &target = _P(i, j);
+        for (int k = 0; k < batch_width; ++k) {
+            target.m[k] = _sweep[k] ? p.m[k] : target.m[k];
+        }
+    }
+}
+
+Lanes BatchedCase::calculate_residual() const {
+    Lanes rloc(0.0);
+    for (auto cell : _grid->fluid_cells()) {
+        Lanes val = _discretization->laplacian(_P, cell->i(), cell->j()) - _RS(cell->i(), cell->j());
+        rloc = rloc + val * val;
+    }
+
+    Lanes res;
+    for (int k = 0; k < batch_width; ++k) {
+        res.m[k] = std::sqrt(rloc.m[k] / _grid->fluid_cells().size());
+    }
+    return res;
+}
+
+void BatchedCase::store(int lane) {
+    Fields &field = _cases[lane]->_field;
+    for (int j = 0; j < _grid->jmaxb(); ++j) {
+        for (int i = 0; i < _grid->imaxb(); ++i) {
+            field.u(i, j) = _U(i, j).m[lane];
+            field.v(i, j) = _V(i, j).m[lane];
+            field.p(i, j) = _P(i, j).m[lane];
+        }
+    }
+}
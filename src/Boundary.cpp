@@ -37,33 +37,49 @@ void FixedWallBoundary::apply(Fields &field) {
     if (cells->is_border(border_position::TOP)) {
       field.u(i, j) = -field.u(i, j + 1);
       field.v(i, j) = 0.0;
-      field.p(i, j) = field.p(i, j + 1);
       field.g(i, j) = field.v(i, j);
       continue;
     }
     if (cells->is_border(border_position::RIGHT)) {
       field.u(i, j) = 0.0;
       field.v(i, j) = -field.v(i + 1, j);
-      field.p(i, j) = field.p(i + 1, j);
       field.f(i, j) = field.u(i, j);
       continue;
     }
     if (cells->is_border(border_position::LEFT)) {
       field.u(i - 1, j) = 0.0;
       field.v(i, j) = -field.v(i - 1, j);
-      field.p(i, j) = field.p(i - 1, j);
       field.f(i - 1, j) = field.u(i - 1, j);
       continue;
     }
     if (cells->is_border(border_position::BOTTOM)) {
       field.u(i, j) = -field.u(i, j - 1);
       field.v(i, j) = 0.0;
-      field.p(i, j) = field.p(i, j - 1);
       field.g(i, j) = field.v(i, j);
       continue;
     }
   }
+  apply_pressure(field);
+}
+
+// Neumann condition for the pressure, also applied by apply
+
+void FixedWallBoundary::apply_pressure(Fields &field) {
+  for (auto cell : _cells) {
+    int i = cell->i();
+    int j = cell->j();
+    if (cell->is_border(border_position::TOP)) {
+      field.p(i, j) = field.p(i, j + 1);
+    } else if (cell->is_border(border_position::RIGHT)) {
+      field.p(i, j) = field.p(i + 1, j);
+    } else if (cell->is_border(border_position::LEFT)) {
+      field.p(i, j) = field.p(i - 1, j);
+    } else if (cell->is_border(border_position::BOTTOM)) {
+      field.p(i, j) = field.p(i, j - 1);
+    }
+  }
 }
+
 //  For the moving wall
 MovingWallBoundary::MovingWallBoundary(std::vector<Cell *> cells,
                                        double wall_velocity)
@@ -93,7 +109,6 @@ void MovingWallBoundary::apply(Fields &field) {
           (2.0) * (_wall_velocity[LidDrivenCavity::moving_wall_id]) -
           field.u(i, j - 1);
       field.v(i, j - 1) = 0.0;
-      field.p(i, j) = field.p(i, j - 1);
       field.g(i, j - 1) = field.v(i, j - 1);
       continue;
     }
@@ -102,7 +117,6 @@ void MovingWallBoundary::apply(Fields &field) {
           (2.0) * (_wall_velocity[LidDrivenCavity::moving_wall_id]) -
           field.u(i, j + 1);
       field.v(i, j - 1) = 0.0;
-      field.p(i, j) = field.p(i, j + 1);
       field.g(i, j) = field.v(i, j);
       continue;
     }
@@ -111,7 +125,6 @@ void MovingWallBoundary::apply(Fields &field) {
       field.v(i, j) =
           (2.0) * (_wall_velocity[LidDrivenCavity::moving_wall_id]) -
           field.v(i + 1, j);
-      field.p(i, j) = field.p(i, j - 1);
       field.f(i, j) = field.u(i, j);
       continue;
     }
@@ -120,9 +133,26 @@ void MovingWallBoundary::apply(Fields &field) {
       field.v(i, j) =
           (2.0) * (_wall_velocity[LidDrivenCavity::moving_wall_id]) -
           field.v(i - 1, j);
-      field.p(i, j) = field.p(i, j - 1);
       field.f(i, j) = field.u(i, j);
       continue;
     }
   }
+  apply_pressure(field);
+}
+
+// Neumann condition for the pressure, also applied by apply
+
+void MovingWallBoundary::apply_pressure(Fields &field) {
+  for (auto cell : _cells) {
+    int i = cell->i();
+    int j = cell->j();
+    if (cell->is_border(border_position::BOTTOM)) {
+      field.p(i, j) = field.p(i, j - 1);
+    } else if (cell->is_border(border_position::TOP)) {
+      field.p(i, j) = field.p(i, j + 1);
+    } else if (cell->is_border(border_position::RIGHT) ||
+               cell->is_border(border_position::LEFT)) {
+      field.p(i, j) = field.p(i, j - 1);
+    }
+  }
 }
@@ -9,17 +9,21 @@ saved in the defined output folder.
 
 #include <algorithm>
 
+#include "Communication.hpp"
+#include "Decomposition.hpp"
 #include "Enums.hpp"
 #ifdef GCC_VERSION_9_OR_HIGHER
 #include <filesystem>
 #else
 #include <experimental/filesystem>
 #endif
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <vector>
 #include <limits>
 
@@ -40,12 +44,27 @@ namespace filesystem = std::experimental::filesystem;
 
 // Read input parameters.
 
-Case::Case(std::string file_name, int argn, char **args) {
+Case::Case(std::string file_name, int argn, char **args)
+    : Case(file_name, {}, "", nullptr) {}
+
+Case::Case(std::string file_name,
+           const std::vector<std::pair<std::string, std::string>> &overrides,
+           const std::string &variant, GridCache *grids)
+    : _variant(variant), _file_name(file_name), _overrides(overrides),
+      _out(&std::cout) {
   const int MAX_LINE_LENGTH = 1024;
-  std::ifstream file(file_name);
+  std::ifstream input(file_name);
+  // The overrides are appended to the file content, later keys winning
+  std::stringstream file;
+  if (input.is_open()) {
+    file << input.rdbuf();
+  }
+  for (const auto &entry : overrides) {
+    file << '\n' << entry.first << ' ' << entry.second;
+  }
   double nu;      /* viscosity   */
-  double UI;      /* velocity x-direction */
-  double VI;      /* velocity y-direction */
+  double UI = 0.0; /* velocity x-direction */
+  double VI = 0.0; /* velocity y-direction */
   double PI;      /* pressure */
   double GX;      /* gravitation x-direction */
   double GY;      /* gravitation y-direction */
@@ -59,16 +78,40 @@ Case::Case(std::string file_name, int argn, char **args) {
   double tau;     /* safety factor for time step*/
   int itermax;    /* max. number of iterations for pressure per time step */
   double eps;     /* accuracy bound for pressure*/
+  std::string viscous{"explicit"}; /* treatment of the viscous terms */
+  std::string integrator{"euler"}; /* time integration scheme */
+  std::string x_stretching{"none"}; /* grid stretching in x-dir. */
+  std::string y_stretching{"none"}; /* grid stretching in y-dir. */
+  double x_stretching_factor = 1.0; /* strength of the stretching in x-dir. */
+  double y_stretching_factor = 1.0; /* strength of the stretching in y-dir. */
+  std::string mode{"transient"};   /* time-accurate or pseudo-transient */
+  double steady_dt_ratio = 10.0;   /* maximum local / global timestep */
+  double wall_velocity = LidDrivenCavity::wall_velocity; /* lid velocity */
+  std::string initial_state{"NONE"}; /* state file of the initial values */
+  std::string monitor_format{"csv"}; /* file format of the monitors */
+  int monitor_buffer = 1024;       /* samples written at once */
+  bool statistics = false;         /* running statistics of the flow */
+  bool statistics_stresses = false; /* covariance of the velocities */
+  std::string output_format{"vtk"}; /* vtk, lossless or lossy snapshots */
+  double snapshot_tolerance = 1e-6; /* largest error of lossy snapshots */
+  int snapshot_keyframe = 10;      /* snapshots from keyframe to keyframe */
+  int output_writers = 0;          /* processes writing collective output */
+  int iproc = 1;                   /* subdomains in x-dir. */
+  int jproc = 1;                   /* subdomains in y-dir. */
+  std::string decomposition{"uniform"}; /* uniform or fluid-weighted */
+  std::string huge_pages{"none"};  /* none, transparent or explicit */
+  bool memory_report = false;      /* placement of the field pages */
 
   // Assigning parameters from the file to variables.
 
-  if (file.is_open()) {
+  if (input.is_open()) {
     std::string var;
     while (!file.eof() && file.good()) {
       file >> var;
       if (var[0] == '#') {
         file.ignore(MAX_LINE_LENGTH, '\n');
       } else {
+        if (var == "geo_file") file >> _geom_name;
         if (var == "xlength") file >> xlength;
         if (var == "ylength") file >> ylength;
         if (var == "nu") file >> nu;
@@ -87,15 +130,100 @@ Case::Case(std::string file_name, int argn, char **args) {
         if (var == "itermax") file >> itermax;
         if (var == "imax") file >> imax;
         if (var == "jmax") file >> jmax;
+        if (var == "p_extrapolation") file >> _p_extrapolation;
+        if (var == "solver") file >> _solver_name;
+        if (var == "omg_adaptive") file >> _omg_adaptive;
+        if (var == "viscous") file >> viscous;
+        if (var == "time_integrator") file >> integrator;
+        if (var == "x_stretching") file >> x_stretching;
+        if (var == "y_stretching") file >> y_stretching;
+        if (var == "x_stretching_factor") file >> x_stretching_factor;
+        if (var == "y_stretching_factor") file >> y_stretching_factor;
+        if (var == "wall_velocity") file >> wall_velocity;
+        if (var == "steady_tol") file >> _steady_tol;
+        if (var == "steady_plateau_tol") file >> _steady_plateau_tol;
+        if (var == "steady_window") file >> _steady_window;
+        if (var == "mode") file >> mode;
+        if (var == "steady_dt_ratio") file >> steady_dt_ratio;
+        if (var == "bootstrap_levels") file >> _bootstrap_levels;
+        if (var == "bootstrap_tol") file >> _bootstrap_tol;
+        if (var == "initial_state") file >> initial_state;
+        if (var == "write_state") file >> _write_state;
+        if (var == "probe") {
+          std::string name;
+          double x, y;
+          if (file >> name >> x >> y) _monitors.add_probe(name, x, y);
+        }
+        if (var == "line") {
+          std::string name;
+          double x0, y0, x1, y1;
+          int points;
+          if (file >> name >> x0 >> y0 >> x1 >> y1 >> points)
+            _monitors.add_line(name, x0, y0, x1, y1, points);
+        }
+        if (var == "forces") {
+          std::string name;
+          int wall_id;
+          if (file >> name >> wall_id) _monitors.add_forces(name, wall_id);
+        }
+        if (var == "monitor_interval") file >> _monitor_interval;
+        if (var == "monitor_buffer") file >> monitor_buffer;
+        if (var == "monitor_format") file >> monitor_format;
+        if (var == "statistics") file >> statistics;
+        if (var == "output_region") {
+          OutputView view{};
+          if (file >> view.name >> view.x0 >> view.y0 >> view.x1 >> view.y1 >>
+              view.interval) {
+            view.stride = 1;
+            _views.push_back(view);
+          }
+        }
+        if (var == "output_stride" || var == "output_average") {
+          OutputView view{};
+          if (file >> view.name >> view.stride >> view.interval) {
+            view.x0 = view.y0 = -std::numeric_limits<double>::max();
+            view.x1 = view.y1 = std::numeric_limits<double>::max();
+            view.average = (var == "output_average");
+            _views.push_back(view);
+          }
+        }
+        if (var == "output_fields") {
+          std::string line, name;
+          std::istringstream names;
+          if (std::getline(file, line)) {
+            names.str(line);
+            _output_pressure = _output_velocity = false;
+          }
+          while (names >> name) {
+            if (name == "pressure") _output_pressure = true;
+            else if (name == "velocity") _output_velocity = true;
+            else if (name == "vorticity") _output_vorticity = true;
+            else if (name == "stream_function") _output_stream_function = true;
+            else if (name == "divergence") _output_divergence = true;
+            else std::cerr << "Unknown output field " << name << std::endl;
+          }
+        }
+        if (var == "statistics_start") file >> _statistics_start;
+        if (var == "statistics_interval") file >> _statistics_interval;
+        if (var == "statistics_stresses") file >> statistics_stresses;
+        if (var == "output_format") file >> output_format;
+        if (var == "snapshot_tolerance") file >> snapshot_tolerance;
+        if (var == "snapshot_keyframe") file >> snapshot_keyframe;
+        if (var == "output_writers") file >> output_writers;
+        if (var == "iproc") file >> iproc;
+        if (var == "jproc") file >> jproc;
+        if (var == "decomposition") file >> decomposition;
+        if (var == "huge_pages") file >> huge_pages;
+        if (var == "memory_report") file >> memory_report;
       }
     }
   }
-  file.close();
+  input.close();
 
   std::map<int, double> wall_vel;
   if (_geom_name.compare("NONE") == 0) {
     wall_vel.insert(std::pair<int, double>(LidDrivenCavity::moving_wall_id,
-                                           LidDrivenCavity::wall_velocity));
+                                           wall_velocity));
   }
 
   // Setting file names for geometry file and output directory
@@ -109,27 +237,204 @@ Case::Case(std::string file_name, int argn, char **args) {
   domain.dy = ylength / static_cast<double>(jmax);
   domain.domain_size_x = imax;
   domain.domain_size_y = jmax;
+  domain.dx_cells =
+      cell_widths(xlength, imax, x_stretching, x_stretching_factor);
+  domain.dy_cells =
+      cell_widths(ylength, jmax, y_stretching, y_stretching_factor);
 
   build_domain(domain, imax, jmax);
 
-  _grid = Grid(_geom_name, domain);
-  _field = Fields(nu, dt, tau, _grid.domain().size_x, _grid.domain().size_y, UI,
-                  VI, PI);
+  if (grids != nullptr) {
+    _grid = grids->get(_geom_name, domain);
+  } else {
+    _grid = std::make_shared<const Grid>(_geom_name, domain);
+  }
+
+  // Planned subdomains of the processes with the fluid cells of each, the
+  // fluid-weighted ones compared to the uniform ones. No process is assigned
+  // a subdomain yet, so the choice only changes the report.
+  if (iproc * jproc > 1) {
+    Decomposition partition(*_grid);
+    auto uniform = partition.uniform(iproc, jproc);
+    if (decomposition == "fluid") {
+      std::cerr << "decomposition fluid has no effect on the solver yet, "
+                   "only the planned subdomains are reported"
+                << std::endl;
+      partition.report(*_out, "Fluid-weighted",
+                       partition.bisection(iproc * jproc));
+      *_out << "  uniform " << iproc << "x" << jproc << " imbalance "
+            << partition.imbalance(uniform) << '\n';
+    } else {
+      if (decomposition != "uniform") {
+        std::cerr << "Unknown decomposition " << decomposition
+                  << ", using uniform" << std::endl;
+      }
+      partition.report(*_out, "Uniform", uniform);
+    }
+  }
+  _field = Fields(nu, dt, tau, _grid->domain().size_x, _grid->domain().size_y,
+                  UI, VI, PI, Arena::pages(huge_pages));
+  if (memory_report) {
+    _field.memory_report(*_out);
+  }
+
+  if (viscous == "implicit") {
+    _field.set_viscous_scheme(viscous_scheme::BACKWARD_EULER);
+  } else if (viscous == "crank_nicolson") {
+    _field.set_viscous_scheme(viscous_scheme::CRANK_NICOLSON);
+  } else if (viscous != "explicit") {
+    std::cerr << "Unknown viscous scheme " << viscous
+              << ", using explicit viscous terms" << std::endl;
+  }
+
+  // Pseudo-transient iterations only need the steady state, for which the
+  // explicit Euler integrator with local timesteps is the cheapest
+  if (mode == "steady") {
+    if (integrator != "euler") {
+      std::cerr << "Steady mode uses the explicit Euler integrator"
+                << std::endl;
+      integrator = "euler";
+    }
+    _field.set_local_timestepping(steady_dt_ratio);
+    if (_steady_tol <= 0.0 && _steady_plateau_tol <= 0.0) {
+      _steady_tol = 1e-6;
+    }
+  } else if (mode != "transient") {
+    std::cerr << "Unknown mode " << mode << ", using the transient mode"
+              << std::endl;
+  }
 
-  _discretization = Discretization(domain.dx, domain.dy, gamma);
-  _pressure_solver = std::make_unique<SOR>(omg);
+  if (integrator == "ab2") {
+    _field.set_time_integrator(time_integrator::ADAMS_BASHFORTH_2);
+  } else if (integrator == "rk3") {
+    _field.set_time_integrator(time_integrator::RUNGE_KUTTA_3);
+  } else if (integrator != "euler") {
+    std::cerr << "Unknown time integrator " << integrator
+              << ", using explicit Euler" << std::endl;
+  }
+
+  _field.set_discretization(
+      Discretization(domain.dx_cells, domain.dy_cells, gamma));
+
+  // SOR unless the direct solver is asked for, which obstacle free
+  // rectangular domains can be solved with by cosine transforms. FFT insists
+  // on the direct solver, auto uses it where the domain allows it.
+  bool direct = _solver_name == "FFT" || _solver_name == "auto";
+  if (not direct && _solver_name != "SOR") {
+    std::cerr << "Unknown pressure solver " << _solver_name << ", using SOR"
+              << std::endl;
+  }
+  bool fast_poisson = direct && FastPoissonSolver::applicable(*_grid);
+  if (_solver_name == "FFT" && not fast_poisson) {
+    std::cerr << "Error: FFT pressure solver requires a uniform domain "
+                 "without obstacles, use solver SOR or auto"
+              << std::endl;
+    Communication::abort();
+  }
+  if (_solver_name == "auto" && not fast_poisson) {
+    std::cout << "Domain not suited for the FFT pressure solver, using SOR"
+              << std::endl;
+  }
+  if (fast_poisson) {
+    _pressure_solver = std::make_unique<FastPoissonSolver>(*_grid);
+  } else {
+    _pressure_solver = std::make_unique<SOR>(omg, _omg_adaptive, _out);
+  }
   _max_iter = itermax;
   _tolerance = eps;
+  _omg = omg;
+  _wall_velocity = wall_velocity;
+  _batchable = mode != "steady" && viscous == "explicit" &&
+               integrator == "euler" &&
+               dynamic_cast<SOR *>(_pressure_solver.get()) != nullptr &&
+               not _omg_adaptive && _p_extrapolation == 0 &&
+               _steady_tol <= 0.0 && _steady_plateau_tol <= 0.0 &&
+               _bootstrap_levels <= 0 && not _write_state &&
+               _monitors.empty() && not statistics && _views.empty();
+  _field.set_pressure_extrapolation(_p_extrapolation);
+
+  // Initial values from the state of an earlier run, possibly on a grid of
+  // another resolution
+  if (initial_state.compare("NONE") != 0) {
+    if (initial_state[0] != '/') {
+      initial_state = _prefix + initial_state;
+    }
+    FlowState state;
+    if (FlowState::read(initial_state, state)) {
+      state.prolongate(_field, *_grid);
+      *_out << "Initial values interpolated from the " << state.imax << "x"
+            << state.jmax << " state " << initial_state << '\n';
+    }
+  }
+  _field.set_change_monitor(_steady_tol > 0.0 || _steady_plateau_tol > 0.0);
+  _steady_window = std::max(_steady_window, 2);
+
+  if (not _monitors.empty()) {
+    if (monitor_format != "csv" && monitor_format != "binary") {
+      std::cerr << "Unknown monitor format " << monitor_format
+                << ", using csv" << std::endl;
+    }
+    _monitor_interval = std::max(_monitor_interval, 1);
+    _monitors.open(*_grid, _dict_name + "/" + _case_name,
+                   monitor_format == "binary", monitor_buffer);
+  }
+
+  // Cells of the views, those whose centres lie in the boxes
+  if (not _views.empty()) {
+    StaggeredLocations locations(*_grid);
+    auto cells = [](const std::vector<double> &centres, double low,
+                    double high, int &first, int &last) {
+      int n = centres.size() - 2;
+      first = 1;
+      while (first < n && centres[first] < low) first++;
+      last = n;
+      while (last > first && centres[last] > high) last--;
+    };
+    for (auto &view : _views) {
+      cells(locations.x_centres(), view.x0, view.x1, view.imin, view.imax);
+      cells(locations.y_centres(), view.y0, view.y1, view.jmin, view.jmax);
+      view.stride = std::max(view.stride, 1);
+      view.next = view.interval;
+    }
+  }
+
+  if (statistics) {
+    _statistics = Statistics(imax, jmax, statistics_stresses);
+    _statistics_on = true;
+  }
+
+  if (output_format == "lossless" || output_format == "lossy") {
+    _compressed = true;
+    _snapshots = SnapshotCodec(output_format == "lossy", snapshot_tolerance,
+                               snapshot_keyframe);
+  } else if (output_format == "mpiio" && grids != nullptr) {
+    // Variants of an ensemble run in threads, which do not call MPI
+    std::cerr << "Collective output is not available in ensembles, using vtk"
+              << std::endl;
+  } else if (output_format == "mpiio") {
+    _collective = true;
+    _collective_output = CollectiveOutput(MPI_COMM_WORLD, output_writers);
+    // The collective files have a fixed layout of pressure and velocity
+    if (not _output_pressure || not _output_velocity || _output_vorticity ||
+        _output_stream_function || _output_divergence) {
+      std::cerr << "Collective output writes pressure and velocity only, "
+                   "ignoring output_fields"
+                << std::endl;
+    }
+  } else if (output_format != "vtk") {
+    std::cerr << "Unknown output format " << output_format << ", using vtk"
+              << std::endl;
+  }
 
   // Constructing boundaries
 
-  if (not _grid.moving_wall_cells().empty()) {
+  if (not _grid->moving_wall_cells().empty()) {
     _boundaries.push_back(std::make_unique<MovingWallBoundary>(
-        _grid.moving_wall_cells(), LidDrivenCavity::wall_velocity));
+        _grid->moving_wall_cells(), wall_velocity));
   }
-  if (not _grid.fixed_wall_cells().empty()) {
+  if (not _grid->fixed_wall_cells().empty()) {
     _boundaries.push_back(
-        std::make_unique<FixedWallBoundary>(_grid.fixed_wall_cells()));
+        std::make_unique<FixedWallBoundary>(_grid->fixed_wall_cells()));
   }
 }
 
@@ -163,6 +468,9 @@ void Case::set_file_names(std::string file_name) {
   _dict_name = temp_dir;
   _dict_name.append(_case_name);
   _dict_name.append("_Output");
+  if (not _variant.empty()) {
+    _dict_name.append("/" + _variant);
+  }
 
   if (_geom_name.compare("NONE") != 0) {
     _geom_name = _prefix + _geom_name;
@@ -172,13 +480,19 @@ void Case::set_file_names(std::string file_name) {
 
   filesystem::path folder(_dict_name);
   try {
-    filesystem::create_directory(folder);
+    filesystem::create_directories(folder);
   } catch (const std::exception &e) {
     std::cerr << "Output directory could not be created." << std::endl;
     std::cerr << "Make sure that you have write permissions to the "
                  "corresponding location"
               << std::endl;
   }
+
+  // Named variants keep their terminal output apart from the other cases
+  if (not _variant.empty()) {
+    _out_file.open(_dict_name + "/output.txt");
+    _out = &_out_file;
+  }
 }
 
 /**
@@ -216,10 +530,22 @@ void Case::simulate() {
   int timestep = 0;
   double output_counter = _output_freq;
   int iter;
-  double res;
+  int step_iter;  // Pressure iterations of all stages of a time step
+  double res = 0.0;
   int total_iter = 1;
+  double res_previous;  // Residual of the previous pressure as initial guess
+  double res_initial;   // Residual of the actual initial guess
+  double saved_iter = 0.0;
+  bool steady_check = _steady_tol > 0.0 || _steady_plateau_tol > 0.0;
+  std::deque<double> change_history;
+  bool sample_due = false;
+  double statistics_output = _statistics_start + _statistics_interval;
   std::ofstream logfile;
-  logfile.open("log.txt");
+  logfile.open(_dict_name + "/log.txt");
+
+  if (_bootstrap_levels > 0) {
+    bootstrap();
+  }
 
   // Following is the actual loop that runs till the defined time limit.
 
@@ -227,56 +553,250 @@ void Case::simulate() {
     for (int i = 0; i < _boundaries.size(); i++) {
       _boundaries[i]->apply(_field);
     }
+    // Recording the monitors of the previous time step, whose ghost cells
+    // are up to date now
+    if (sample_due) {
+      _monitors.sample(_field, *_grid, timestep, t);
+    }
     // Calculating timestep for advancement to the next iteration.
-    dt = _field.calculate_dt(_grid);
+    dt = _field.calculate_dt(*_grid);
 
-    // Calculating Fluxes (_F and _G) for velocities in X and Y direction
-    // respectively.
-    _field.calculate_fluxes(_grid);
+    // Multistage time integrators project the velocities in every stage
+    step_iter = 0;
+    for (int stage = 0; stage < _field.stages(); stage++) {
+      if (stage > 0) {
+        for (auto &boundary : _boundaries) {
+          boundary->apply(_field);
+        }
+      }
 
-    // Calculating RHS for pressure poisson equation
-    _field.calculate_rs(_grid);
+      // Calculating Fluxes (_F and _G) for velocities in X and Y direction
+      // respectively.
+      _field.calculate_fluxes(*_grid, stage);
 
-    iter = 0;    // Pressure poisson solver iteration initialization
-    res = std::numeric_limits<double>::max();  // Any value greatrer than tolerance.
+      // Calculating RHS for pressure poisson equation
+      _field.calculate_rs(*_grid);
 
-    while (res > _tolerance) {
-      if (iter >= _max_iter) {
-        std::cout << "Pressure poisson solver did not converge to the given "
-                     "tolerance...\n";
-        break;
+      // Warm start: extrapolating the initial guess of the pressure from the
+      // previous time levels, kept only if it is better than the previous
+      // pressure itself. Later stages start from the pressure of the
+      // previous stage.
+      res_initial = res_previous = 0.0;
+      if (_p_extrapolation > 0 && stage == 0) {
+        _field.store_pressure(t);
+        res_previous = _field.calculate_residual(*_grid);
+        if (_field.extrapolate_pressure(*_grid, t + dt)) {
+          res_initial = _field.calculate_residual(*_grid);
+          if (res_initial >= res_previous) {
+            _field.restore_pressure();
+            res_initial = res_previous;
+          }
+        } else {
+          res_initial = res_previous;
+        }
+      }
+
+      _pressure_solver->start_timestep();
+      iter = 0;    // Pressure poisson solver iteration initialization
+      res = std::numeric_limits<double>::max();  // Any value greatrer than tolerance.
+
+      while (res > _tolerance) {
+        if (iter >= _max_iter) {
+          *_out << "Pressure poisson solver did not converge to the given "
+                       "tolerance...\n";
+          break;
+        }
+        res = _pressure_solver->solve(_field, *_grid, _boundaries);
+        iter++;
+        total_iter++;
+        logfile << "Residual: " << res << " Iteration:" << total_iter << '\n';
+      }
+      step_iter += iter;
+
+      // Estimating the saved iterations from the observed contraction rate
+      // of the solver in this time step
+      if (res_initial < res_previous && res < res_initial) {
+        double rate = std::pow(res / res_initial, 1.0 / iter);
+        double saved = std::log(res_initial / res_previous) / std::log(rate);
+        saved_iter += saved;
+        logfile << "Warm start: initial residual " << res_previous << " -> "
+                << res_initial << ", saved iterations: " << saved << '\n';
       }
-      res = _pressure_solver->solve(_field, _grid, _boundaries);
-      iter++;
-      total_iter++;
-      logfile << "Residual: " << res << " Iteration:" << total_iter << '\n';
-    }
 
-    // Calculating updated velocities using pressure calculated in the
-    // pressure poisson equation
-    _field.calculate_velocities(_grid);
+      // Calculating updated velocities using pressure calculated in the
+      // pressure poisson equation
+      _field.calculate_velocities(*_grid);
+    }
 
     // Updating t for the next step
     t += dt;
     timestep++;
 
     // Printing Data in the terminal
-    std::cout << "Timestep size: " << setw(10) << dt << " | "
+    *_out << "Timestep size: " << setw(10) << dt << " | "
               << "Time: " << setw(8) << t << setw(3) << " | "
               << "Residual: " << setw(11) << res << setw(3) << " | "
-              << "Pressure Poisson Iterations: " << setw(3) << iter << '\n';
+              << "Pressure Poisson Iterations: " << setw(3) << step_iter << '\n';
+    sample_due = not _monitors.empty() && timestep % _monitor_interval == 0;
+
+    // Time averages from statistics_start on, written every
+    // statistics_interval and at the end
+    if (_statistics_on && t > _statistics_start) {
+      _statistics.accumulate(_field, *_grid,
+                             std::min(dt, t - _statistics_start));
+      if (_statistics_interval > 0.0 && t >= statistics_output) {
+        output_statistics(timestep);
+        statistics_output += _statistics_interval;
+      }
+    }
+
+    bool written = false;
     if (t >= _output_freq) {
-      output_vtk(timestep);
+      output(timestep, t);
       _output_freq = _output_freq + output_counter;
+      written = true;
     }
+    for (auto &view : _views) {
+      if (t >= view.next) {
+        output_view(view, timestep);
+        view.next += view.interval;
+      }
+    }
+
+    // Stopping once the flow is steady, with a final snapshot
+    if (steady_check) {
+      std::string reason = steady_state(change_history);
+      if (not reason.empty()) {
+        const auto &change = _field.relative_change();
+        *_out << "Steady state reached at time " << t << " after " << timestep
+              << " time steps (" << reason << "), relative change per unit "
+              << "time: U " << change[0] << ", V " << change[1] << ", P "
+              << change[2] << '\n';
+        if (not written) {
+          output(timestep, t);
+        }
+        break;
+      }
+    }
+  }
+
+  if (_p_extrapolation > 0) {
+    *_out << "Pressure warm start saved approximately "
+              << static_cast<int>(saved_iter) << " of " << total_iter - 1
+              << " pressure Poisson iterations\n";
+  }
+
+  if (_statistics_on && _statistics.samples() > 0) {
+    output_statistics(timestep);
+  }
+  if (sample_due) {
+    for (auto &boundary : _boundaries) {
+      boundary->apply(_field);
+    }
+    _monitors.sample(_field, *_grid, timestep, t);
+  }
+  if (not _monitors.empty()) {
+    _monitors.flush();
+  }
+  if (_write_state) {
+    current_state().write(_dict_name + "/" + _case_name + ".state");
   }
 
   logfile.close();
 }
 
-// Following is the pre-defined function for writing the output files.
+// The case is first simulated on a grid with half as many cells in each
+// direction until the coarse flow is steady to bootstrap_tol (or t_end),
+// itself bootstrapped from the next coarser grid. Its flow is interpolated
+// as the initial values of this grid, so the fine grid only has to resolve
+// what the coarse one could not.
 
-void Case::output_vtk(int timestep, int rank) {
+void Case::bootstrap() {
+  int imax = _grid->imax() / 2;
+  int jmax = _grid->jmax() / 2;
+  if (_geom_name.compare("NONE") != 0) {
+    std::cerr << "Bootstrapping needs a domain without geometry file, "
+                 "starting from the initial values"
+              << std::endl;
+    return;
+  }
+  if (imax < 2 || jmax < 2) {
+    std::cerr << "Grid too coarse for " << _bootstrap_levels
+              << " bootstrap levels, starting from the initial values"
+              << std::endl;
+    return;
+  }
+
+  // The coarse case writes its output into a subdirectory of this one
+  auto text = [](double value) {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+  };
+  auto overrides = _overrides;
+  overrides.emplace_back("imax", std::to_string(imax));
+  overrides.emplace_back("jmax", std::to_string(jmax));
+  overrides.emplace_back("bootstrap_levels",
+                         std::to_string(_bootstrap_levels - 1));
+  overrides.emplace_back("steady_tol", text(_bootstrap_tol));
+  overrides.emplace_back("dt_value", text(2.0 * _t_end + 1.0));
+  overrides.emplace_back("write_state", "0");
+  std::string name = "bootstrap_" + std::to_string(imax) + "x" +
+                     std::to_string(jmax);
+  Case coarse(_file_name, overrides,
+              _variant.empty() ? name : _variant + "/" + name, nullptr);
+
+  auto start = std::chrono::steady_clock::now();
+  coarse.simulate();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  coarse.current_state().prolongate(_field, *_grid);
+  // The steady state detection compares with the new initial pressure
+  _field.set_change_monitor(_steady_tol > 0.0 || _steady_plateau_tol > 0.0);
+  *_out << "Initial values interpolated from the " << imax << "x" << jmax
+        << " grid, simulated in " << elapsed.count() << " s\n";
+}
+
+FlowState Case::current_state() {
+  for (auto &boundary : _boundaries) {
+    boundary->apply(_field);
+  }
+  return FlowState::capture(_field, *_grid);
+}
+
+// The change of the last time step is compared with the tolerance; a plateau
+// is a window of time steps whose newer half did not get below 99% of the
+// minimum of the older half, i.e. the change stagnates, e.g. at the level of
+// the solver tolerance.
+
+std::string Case::steady_state(std::deque<double> &history) const {
+  const auto &change = _field.relative_change();
+  double current = std::max({change[0], change[1], change[2]});
+  history.push_back(current);
+  if (static_cast<int>(history.size()) > _steady_window) {
+    history.pop_front();
+  }
+
+  if (_steady_tol > 0.0 && current < _steady_tol) {
+    return "change below steady_tol";
+  }
+  if (_steady_plateau_tol > 0.0 &&
+      static_cast<int>(history.size()) == _steady_window &&
+      current < _steady_plateau_tol) {
+    auto middle = history.begin() + _steady_window / 2;
+    double older = *std::min_element(history.begin(), middle);
+    double newer = *std::min_element(middle, history.end());
+    if (newer >= 0.99 * older) {
+      return "change stagnates below steady_plateau_tol";
+    }
+  }
+  return "";
+}
+
+namespace {
+// Structured grid of the cell corners of the inner cells
+vtkSmartPointer<vtkStructuredGrid> structured_grid(const Grid &grid) {
   // Creating a new structured grid
   vtkSmartPointer<vtkStructuredGrid> structuredGrid =
       vtkSmartPointer<vtkStructuredGrid>::New();
@@ -284,31 +804,39 @@ void Case::output_vtk(int timestep, int rank) {
   // Creating grid
   vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
 
-  double dx = _grid.dx();
-  double dy = _grid.dy();
+  double dx = grid.dx();
+  double dy = grid.dy();
 
-  double x = _grid.domain().imin * dx;
-  double y = _grid.domain().jmin * dy;
+  double x = grid.domain().imin * dx;
+  double y = grid.domain().jmin * dy;
 
-  { y += dy; }
-  { x += dx; }
+  { y += grid.dy(0); }
+  { x += grid.dx(0); }
 
   double z = 0;
-  for (int col = 0; col < _grid.domain().size_y + 1; col++) {
-    x = _grid.domain().imin * dx;
-    { x += dx; }
-    for (int row = 0; row < _grid.domain().size_x + 1; row++) {
+  for (int col = 0; col < grid.domain().size_y + 1; col++) {
+    x = grid.domain().imin * dx;
+    { x += grid.dx(0); }
+    for (int row = 0; row < grid.domain().size_x + 1; row++) {
       points->InsertNextPoint(x, y, z);
-      x += dx;
+      x += grid.dx(row + 1);
     }
-    y += dy;
+    y += grid.dy(col + 1);
   }
 
   // Specify the dimensions of the grid, addition of 1 to accomodate
   // neighboring cells
-  structuredGrid->SetDimensions(_grid.domain().size_x + 1,
-                                _grid.domain().size_y + 1, 1);
+  structuredGrid->SetDimensions(grid.domain().size_x + 1,
+                                grid.domain().size_y + 1, 1);
   structuredGrid->SetPoints(points);
+  return structuredGrid;
+}
+}  // namespace
+
+// Following is the pre-defined function for writing the output files.
+
+void Case::output_vtk(int timestep, int rank) {
+  vtkSmartPointer<vtkStructuredGrid> structuredGrid = structured_grid(*_grid);
 
   // Pressure Array
   vtkDoubleArray *Pressure = vtkDoubleArray::New();
@@ -321,8 +849,8 @@ void Case::output_vtk(int timestep, int rank) {
   Velocity->SetNumberOfComponents(3);
 
   // Print pressure and temperature from bottom to top
-  for (int j = 1; j < _grid.domain().size_y + 1; j++) {
-    for (int i = 1; i < _grid.domain().size_x + 1; i++) {
+  for (int j = 1; j < _grid->domain().size_y + 1 && _output_pressure; j++) {
+    for (int i = 1; i < _grid->domain().size_x + 1; i++) {
       double pressure = _field.p(i, j);
       Pressure->InsertNextTuple(&pressure);
     }
@@ -332,20 +860,63 @@ void Case::output_vtk(int timestep, int rank) {
   float vel[3];
   vel[2] = 0;  // Set z component to 0
 
-  // Print Velocity from bottom to top
-  for (int j = 0; j < _grid.domain().size_y + 1; j++) {
-    for (int i = 0; i < _grid.domain().size_x + 1; i++) {
-      vel[0] = (_field.u(i, j) + _field.u(i, j + 1)) * 0.5;
-      vel[1] = (_field.v(i, j) + _field.v(i + 1, j)) * 0.5;
+  // Print Velocity from bottom to top, interpolated linearly to the corners
+  for (int j = 0; j < _grid->domain().size_y + 1 && _output_velocity; j++) {
+    for (int i = 0; i < _grid->domain().size_x + 1; i++) {
+      vel[0] = (_grid->dy(j + 1) * _field.u(i, j) +
+                _grid->dy(j) * _field.u(i, j + 1)) /
+               (_grid->dy(j) + _grid->dy(j + 1));
+      vel[1] = (_grid->dx(i + 1) * _field.v(i, j) +
+                _grid->dx(i) * _field.v(i + 1, j)) /
+               (_grid->dx(i) + _grid->dx(i + 1));
       Velocity->InsertNextTuple(vel);
     }
   }
 
   // Add Pressure to Structured Grid
-  structuredGrid->GetCellData()->AddArray(Pressure);
+  if (_output_pressure) {
+    structuredGrid->GetCellData()->AddArray(Pressure);
+  }
 
   // Add Velocity to Structured Grid
-  structuredGrid->GetPointData()->AddArray(Velocity);
+  if (_output_velocity) {
+    structuredGrid->GetPointData()->AddArray(Velocity);
+  }
+
+  // Derived fields, computed only when they are written
+  auto add = [&](const char *name, const Matrix<double> &values, int first,
+                 bool cells) {
+    vtkDoubleArray *array = vtkDoubleArray::New();
+    array->SetName(name);
+    array->SetNumberOfComponents(1);
+    int nx = _grid->domain().size_x + (cells ? 0 : 1);
+    int ny = _grid->domain().size_y + (cells ? 0 : 1);
+    for (int j = first; j < first + ny; j++) {
+      for (int i = first; i < first + nx; i++) {
+        double value = values(i, j);
+        array->InsertNextTuple(&value);
+      }
+    }
+    if (cells) {
+      structuredGrid->GetCellData()->AddArray(array);
+    } else {
+      structuredGrid->GetPointData()->AddArray(array);
+    }
+  };
+  Matrix<double> derived;
+  if (_output_vorticity) {
+    _field.calculate_vorticity(*_grid, derived);
+    add("vorticity", derived, 0, false);
+  }
+  if (_output_stream_function) {
+    _field.calculate_stream_function(*_grid, derived);
+    add("stream_function", derived, 0, false);
+  }
+  if (_output_divergence) {
+    double largest = _field.calculate_divergence(*_grid, derived);
+    add("divergence", derived, 1, true);
+    *_out << "Largest divergence of the velocities: " << largest << '\n';
+  }
 
   // Write Grid
   vtkSmartPointer<vtkStructuredGridWriter> writer =
@@ -360,6 +931,156 @@ void Case::output_vtk(int timestep, int rank) {
   writer->Write();
 }
 
+void Case::output(int timestep, double t) {
+  if (_collective) {
+    _collective_output.write(_dict_name + '/' + _case_name + "_" +
+                                 std::to_string(timestep) + ".vtk",
+                             _case_name + " time step " +
+                                 std::to_string(timestep),
+                             _field, *_grid);
+    return;
+  }
+  if (not _compressed) {
+    output_vtk(timestep);
+    return;
+  }
+  _snapshots.write(_dict_name + '/' + _case_name + "_" +
+                       std::to_string(timestep) + ".fcs",
+                   FlowState::capture(_field, *_grid), timestep, t);
+}
+
+// The blocks of a view start at its lower left cell, the last ones being
+// cut off at the end of the view. The points are placed like the ones of
+// output_vtk.
+
+void Case::output_view(const OutputView &view, int timestep) {
+  StaggeredLocations locations(*_grid);
+  const auto &x_faces = locations.x_faces();
+  const auto &y_faces = locations.y_faces();
+  int s = view.stride;
+  int blocks_x = (view.imax - view.imin) / s + 1;
+  int blocks_y = (view.jmax - view.jmin) / s + 1;
+
+  vtkSmartPointer<vtkStructuredGrid> structuredGrid =
+      vtkSmartPointer<vtkStructuredGrid>::New();
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  for (int J = 0; J < blocks_y + 1; J++) {
+    double y = y_faces[std::min(view.jmin - 1 + s * J, view.jmax)] +
+               _grid->dy(0);
+    for (int I = 0; I < blocks_x + 1; I++) {
+      double x = x_faces[std::min(view.imin - 1 + s * I, view.imax)] +
+                 _grid->dx(0);
+      points->InsertNextPoint(x, y, 0.0);
+    }
+  }
+  structuredGrid->SetDimensions(blocks_x + 1, blocks_y + 1, 1);
+  structuredGrid->SetPoints(points);
+
+  vtkDoubleArray *Pressure = vtkDoubleArray::New();
+  Pressure->SetName("pressure");
+  Pressure->SetNumberOfComponents(1);
+  vtkDoubleArray *Velocity = vtkDoubleArray::New();
+  Velocity->SetName("velocity");
+  Velocity->SetNumberOfComponents(3);
+
+  for (int J = 0; J < blocks_y; J++) {
+    for (int I = 0; I < blocks_x; I++) {
+      int i0 = view.imin + s * I;
+      int i1 = std::min(i0 + s - 1, view.imax);
+      int j0 = view.jmin + s * J;
+      int j1 = std::min(j0 + s - 1, view.jmax);
+      if (not view.average) {
+        i0 = i1 = std::min(i0 + s / 2, i1);
+        j0 = j1 = std::min(j0 + s / 2, j1);
+      }
+      // Cell centred values, weighted with the cell areas
+      double area = 0.0;
+      double pressure = 0.0;
+      double vel[3] = {0.0, 0.0, 0.0};
+      for (int j = j0; j < j1 + 1; j++) {
+        for (int i = i0; i < i1 + 1; i++) {
+          double a = _grid->dx(i) * _grid->dy(j);
+          area += a;
+          pressure += a * _field.p(i, j);
+          vel[0] += a * 0.5 * (_field.u(i - 1, j) + _field.u(i, j));
+          vel[1] += a * 0.5 * (_field.v(i, j - 1) + _field.v(i, j));
+        }
+      }
+      pressure /= area;
+      vel[0] /= area;
+      vel[1] /= area;
+      Pressure->InsertNextTuple(&pressure);
+      Velocity->InsertNextTuple(vel);
+    }
+  }
+  structuredGrid->GetCellData()->AddArray(Pressure);
+  structuredGrid->GetCellData()->AddArray(Velocity);
+
+  vtkSmartPointer<vtkStructuredGridWriter> writer =
+      vtkSmartPointer<vtkStructuredGridWriter>::New();
+  std::string outputname = _dict_name + '/' + _case_name + "_" + view.name +
+                           "_" + std::to_string(timestep) + ".vtk";
+  writer->SetFileName(outputname.c_str());
+  writer->SetInputData(structuredGrid);
+  writer->Write();
+}
+
+// Statistics of the cell centres as cell data of the same grid
+
+void Case::output_statistics(int timestep) {
+  vtkSmartPointer<vtkStructuredGrid> structuredGrid = structured_grid(*_grid);
+
+  const Statistics::Quantity quantities[3] = {Statistics::U, Statistics::V,
+                                              Statistics::P};
+  const std::string names[3] = {"u", "v", "pressure"};
+  auto add = [&](const std::string &name, auto value) {
+    vtkDoubleArray *array = vtkDoubleArray::New();
+    array->SetName(name.c_str());
+    array->SetNumberOfComponents(1);
+    for (int j = 1; j < _grid->domain().size_y + 1; j++) {
+      for (int i = 1; i < _grid->domain().size_x + 1; i++) {
+        double tuple = value(i, j);
+        array->InsertNextTuple(&tuple);
+      }
+    }
+    structuredGrid->GetCellData()->AddArray(array);
+  };
+
+  for (int q = 0; q < 3; q++) {
+    Statistics::Quantity quantity = quantities[q];
+    add("mean_" + names[q],
+        [&](int i, int j) { return _statistics.mean(quantity, i, j); });
+    add("rms_" + names[q],
+        [&](int i, int j) { return _statistics.rms(quantity, i, j); });
+    add("min_" + names[q],
+        [&](int i, int j) { return _statistics.min(quantity, i, j); });
+    add("max_" + names[q],
+        [&](int i, int j) { return _statistics.max(quantity, i, j); });
+  }
+  if (_statistics.stresses()) {
+    add("reynolds_stress_uu", [&](int i, int j) {
+      return _statistics.variance(Statistics::U, i, j);
+    });
+    add("reynolds_stress_vv", [&](int i, int j) {
+      return _statistics.variance(Statistics::V, i, j);
+    });
+    add("reynolds_stress_uv",
+        [&](int i, int j) { return _statistics.covariance(i, j); });
+  }
+
+  vtkSmartPointer<vtkStructuredGridWriter> writer =
+      vtkSmartPointer<vtkStructuredGridWriter>::New();
+  std::string outputname = _dict_name + '/' + _case_name + "_statistics_" +
+                           std::to_string(timestep) + ".vtk";
+  writer->SetFileName(outputname.c_str());
+  writer->SetInputData(structuredGrid);
+  writer->Write();
+
+  *_out << "Statistics of " << _statistics.samples() << " time steps over "
+        << _statistics.time() << " time units written to " << outputname
+        << '\n';
+}
+
 void Case::build_domain(Domain &domain, int imax_domain, int jmax_domain) {
   domain.imin = 0;
   domain.jmin = 0;
@@ -368,3 +1089,38 @@ void Case::build_domain(Domain &domain, int imax_domain, int jmax_domain) {
   domain.size_x = imax_domain;
   domain.size_y = jmax_domain;
 }
+
+std::vector<double> Case::cell_widths(double length, int n,
+                                      const std::string &stretching,
+                                      double factor) {
+  std::vector<double> widths(n + 2, length / static_cast<double>(n));
+
+  if (stretching == "tanh" && factor > 0.0) {
+    // Faces clustered towards both walls, the larger the factor the stronger
+    auto face = [&](int k) {
+      return 0.5 * length *
+             (1.0 + std::tanh(factor * (2.0 * k / n - 1.0)) / std::tanh(factor));
+    };
+    for (int i = 1; i < n + 1; i++) {
+      widths[i] = face(i) - face(i - 1);
+    }
+  } else if (stretching == "geometric" && factor > 0.0 && factor != 1.0) {
+    // Each cell is factor times as wide as the previous one, a factor below
+    // one refines towards the upper wall
+    double width = length * (1.0 - factor) / (1.0 - std::pow(factor, n));
+    for (int i = 1; i < n + 1; i++) {
+      widths[i] = width;
+      width *= factor;
+    }
+  } else if (stretching != "none" && stretching != "tanh" &&
+             stretching != "geometric") {
+    std::cerr << "Unknown grid stretching " << stretching
+              << ", using a uniform grid" << std::endl;
+  }
+
+  // Ghost cells mirror the adjacent inner cells, so the walls lie midway
+  // between the ghost and inner cell centres
+  widths[0] = widths[1];
+  widths[n + 1] = widths[n];
+  return widths;
+}
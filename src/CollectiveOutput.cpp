@@ -0,0 +1,163 @@
+/*
+In this file, we write the fields of all subdomains into one binary legacy
+VTK file with collective MPI-IO.
+*/
+#include "CollectiveOutput.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+/// Value with the bytes in big endian order, as legacy VTK files expect
+double big_endian(double x) {
+    const std::uint16_t probe = 1;
+    if (*reinterpret_cast<const std::uint8_t *>(&probe) == 0) {
+        return x;
+    }
+    std::uint64_t b;
+    std::memcpy(&b, &x, sizeof(b));
+    b = __builtin_bswap64(b);
+    std::memcpy(&x, &b, sizeof(x));
+    return x;
+}
+} // namespace
+
+CollectiveOutput::CollectiveOutput(MPI_Comm communicator, int writers)
+    : _communicator(communicator), _writers(writers) {}
+
+int CollectiveOutput::write_block(MPI_File file, MPI_Offset offset, const std::vector<int> &sizes,
+                                  const std::vector<int> &starts, const std::vector<int> &block,
+                                  const std::vector<double> &values) {
+    bool empty = false;
+    for (int size : block) {
+        empty = empty || size == 0;
+    }
+    if (empty) {
+        MPI_File_set_view(file, offset, MPI_DOUBLE, MPI_DOUBLE, "native", MPI_INFO_NULL);
+        return MPI_File_write_all(file, nullptr, 0, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    }
+    MPI_Datatype subarray;
+    MPI_Type_create_subarray(sizes.size(), sizes.data(), block.data(), starts.data(), MPI_ORDER_C, MPI_DOUBLE,
+                             &subarray);
+    MPI_Type_commit(&subarray);
+    MPI_File_set_view(file, offset, MPI_DOUBLE, subarray, "native", MPI_INFO_NULL);
+    int error = MPI_File_write_all(file, values.data(), values.size(), MPI_DOUBLE, MPI_STATUS_IGNORE);
+    MPI_Type_free(&subarray);
+    return error;
+}
+
+bool CollectiveOutput::write(const std::string &file_name, const std::string &title, Fields &field,
+                             const Grid &grid) const {
+    const Domain &domain = grid.domain();
+    const int nx = domain.domain_size_x;
+    const int ny = domain.domain_size_y;
+    // Corners of the subdomain, the upper and right ones only at the
+    // boundary of the domain
+    const int px = grid.imax() + (domain.imin + grid.imax() == nx ? 1 : 0);
+    const int py = grid.jmax() + (domain.jmin + grid.jmax() == ny ? 1 : 0);
+    const int points = (nx + 1) * (ny + 1);
+
+    // Text sections in front of the arrays, the same on all processes
+    std::vector<std::string> text = {
+        "# vtk DataFile Version 3.0\n" + title + "\nBINARY\nDATASET RECTILINEAR_GRID\nDIMENSIONS " +
+            std::to_string(nx + 1) + " " + std::to_string(ny + 1) + " 1\nX_COORDINATES " + std::to_string(nx + 1) +
+            " double\n",
+        "\nY_COORDINATES " + std::to_string(ny + 1) + " double\n",
+        "\nZ_COORDINATES 1 double\n",
+        "\nCELL_DATA " + std::to_string(nx * ny) + "\nSCALARS pressure double 1\nLOOKUP_TABLE default\n",
+        "\nPOINT_DATA " + std::to_string(points) + "\nVECTORS velocity double\n",
+        "\n"};
+    const MPI_Offset array_bytes[5] = {static_cast<MPI_Offset>(nx + 1) * 8, static_cast<MPI_Offset>(ny + 1) * 8, 8,
+                                       static_cast<MPI_Offset>(nx) * ny * 8, static_cast<MPI_Offset>(points) * 3 * 8};
+    MPI_Offset text_offset[6];
+    MPI_Offset array_offset[5];
+    MPI_Offset offset = 0;
+    for (int k = 0; k < 6; ++k) {
+        text_offset[k] = offset;
+        offset += text[k].size();
+        if (k < 5) {
+            array_offset[k] = offset;
+            offset += array_bytes[k];
+        }
+    }
+
+    // Local blocks, coordinates written by the subdomains at the lower and
+    // left boundary
+    std::vector<double> x(px);
+    std::vector<double> y(py);
+    x[0] = domain.imin * domain.dx + grid.dx(0);
+    for (int i = 1; i < px; ++i) {
+        x[i] = x[i - 1] + grid.dx(i);
+    }
+    y[0] = domain.jmin * domain.dy + grid.dy(0);
+    for (int j = 1; j < py; ++j) {
+        y[j] = y[j - 1] + grid.dy(j);
+    }
+    for (double &value : x) {
+        value = big_endian(value);
+    }
+    for (double &value : y) {
+        value = big_endian(value);
+    }
+
+    std::vector<double> pressure;
+    pressure.reserve(grid.imax() * grid.jmax());
+    for (int j = 1; j < grid.jmax() + 1; ++j) {
+        for (int i = 1; i < grid.imax() + 1; ++i) {
+            pressure.push_back(big_endian(field.p(i, j)));
+        }
+    }
+
+    std::vector<double> velocity;
+    velocity.reserve(3 * px * py);
+    for (int j = 0; j < py; ++j) {
+        for (int i = 0; i < px; ++i) {
+            velocity.push_back(big_endian((grid.dy(j + 1) * field.u(i, j) + grid.dy(j) * field.u(i, j + 1)) /
+                                          (grid.dy(j) + grid.dy(j + 1))));
+            velocity.push_back(big_endian((grid.dx(i + 1) * field.v(i, j) + grid.dx(i) * field.v(i + 1, j)) /
+                                          (grid.dx(i) + grid.dx(i + 1))));
+            velocity.push_back(0.0);
+        }
+    }
+
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "romio_cb_write", "enable");
+    if (_writers > 0) {
+        MPI_Info_set(info, "cb_nodes", std::to_string(_writers).c_str());
+    }
+    MPI_File file;
+    int error = MPI_File_open(_communicator, file_name.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, info, &file);
+    MPI_Info_free(&info);
+    if (error != MPI_SUCCESS) {
+        std::cerr << "Output file " << file_name << " could not be opened" << std::endl;
+        return false;
+    }
+    MPI_File_set_size(file, offset);
+
+    int rank;
+    MPI_Comm_rank(_communicator, &rank);
+    if (rank == 0) {
+        for (int k = 0; k < 6; ++k) {
+            error |= MPI_File_write_at(file, text_offset[k], text[k].data(), text[k].size(), MPI_CHAR,
+                                       MPI_STATUS_IGNORE);
+        }
+        double z = 0.0;
+        error |= MPI_File_write_at(file, array_offset[2], &z, 1, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    }
+
+    error |= write_block(file, array_offset[0], {nx + 1}, {domain.imin}, {domain.jmin == 0 ? px : 0}, x);
+    error |= write_block(file, array_offset[1], {ny + 1}, {domain.jmin}, {domain.imin == 0 ? py : 0}, y);
+    error |= write_block(file, array_offset[3], {ny, nx}, {domain.jmin, domain.imin}, {grid.jmax(), grid.imax()},
+                         pressure);
+    error |= write_block(file, array_offset[4], {ny + 1, nx + 1, 3}, {domain.jmin, domain.imin, 0}, {py, px, 3},
+                         velocity);
+    MPI_File_close(&file);
+
+    if (error != MPI_SUCCESS) {
+        std::cerr << "Output file " << file_name << " could not be written" << std::endl;
+        return false;
+    }
+    return true;
+}
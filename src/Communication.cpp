@@ -0,0 +1,25 @@
+/*
+In this file, we set up MPI and query the processes of the run.
+*/
+#include "Communication.hpp"
+
+void Communication::init_parallel(int argn, char **args) {
+    int provided;
+    MPI_Init_thread(&argn, &args, MPI_THREAD_FUNNELED, &provided);
+}
+
+void Communication::finalize() { MPI_Finalize(); }
+
+void Communication::abort() { MPI_Abort(MPI_COMM_WORLD, 1); }
+
+int Communication::get_rank() {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank;
+}
+
+int Communication::get_size() {
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return size;
+}
@@ -0,0 +1,144 @@
+/*
+In this file, we compute discrete cosine transforms through a complex FFT of
+the same length (Makhoul's reordering). Lengths which are not a power of two
+are handled with Bluestein's algorithm on a zero padded radix-2 FFT.
+*/
+#include "CosineTransform.hpp"
+
+#include <cmath>
+
+CosineTransform::CosineTransform(int n) : _n(n) {
+  const double pi = std::acos(-1.0);
+
+  _m = 1;
+  while (_m < _n) {
+    _m *= 2;
+  }
+  if (_m != _n) {
+    _bluestein = true;
+    _m = 1;
+    while (_m < 2 * _n - 1) {
+      _m *= 2;
+    }
+  }
+
+  _twiddle.resize(_m / 2);
+  for (int k = 0; k < _m / 2; ++k) {
+    _twiddle[k] = std::polar(1.0, -2.0 * pi * k / _m);
+  }
+
+  if (_bluestein) {
+    _chirp.resize(_n);
+    _chirp_fft.assign(_m, 0.0);
+    for (int k = 0; k < _n; ++k) {
+      // k^2 modulo 2n keeps the argument accurate for long sequences
+      long long k2 = (static_cast<long long>(k) * k) % (2 * _n);
+      _chirp[k] = std::polar(1.0, -pi * k2 / _n);
+      _chirp_fft[k] = std::conj(_chirp[k]);
+      if (k > 0) {
+        _chirp_fft[_m - k] = std::conj(_chirp[k]);
+      }
+    }
+    fft_radix2(_chirp_fft, false);
+    _padded.resize(_m);
+  }
+
+  _shift.resize(_n);
+  for (int k = 0; k < _n; ++k) {
+    _shift[k] = std::polar(1.0, -pi * k / (2.0 * _n));
+  }
+  _buffer.resize(_n);
+}
+
+void CosineTransform::forward(double *data, int stride) {
+  // Even elements in ascending, odd elements in descending order
+  for (int k = 0; 2 * k < _n; ++k) {
+    _buffer[k] = data[2 * k * stride];
+  }
+  for (int k = 0; 2 * k + 1 < _n; ++k) {
+    _buffer[_n - 1 - k] = data[(2 * k + 1) * stride];
+  }
+
+  fft(_buffer, false);
+
+  for (int k = 0; k < _n; ++k) {
+    data[k * stride] = std::real(_shift[k] * _buffer[k]);
+  }
+}
+
+void CosineTransform::backward(double *data, int stride) {
+  _buffer[0] = data[0];
+  for (int k = 1; k < _n; ++k) {
+    _buffer[k] = std::conj(_shift[k]) *
+                 std::complex<double>(data[k * stride],
+                                      -data[(_n - k) * stride]);
+  }
+
+  fft(_buffer, true);
+
+  for (int k = 0; 2 * k < _n; ++k) {
+    data[2 * k * stride] = std::real(_buffer[k]) / _n;
+  }
+  for (int k = 0; 2 * k + 1 < _n; ++k) {
+    data[(2 * k + 1) * stride] = std::real(_buffer[_n - 1 - k]) / _n;
+  }
+}
+
+int CosineTransform::size() const { return _n; }
+
+void CosineTransform::fft(std::vector<std::complex<double>> &a, bool inverse) {
+  if (not _bluestein) {
+    fft_radix2(a, inverse);
+    return;
+  }
+
+  // The inverse transform is the conjugate of the forward transform of the
+  // conjugated sequence
+  std::fill(_padded.begin(), _padded.end(), 0.0);
+  for (int k = 0; k < _n; ++k) {
+    std::complex<double> x = inverse ? std::conj(a[k]) : a[k];
+    _padded[k] = x * _chirp[k];
+  }
+  fft_radix2(_padded, false);
+  for (int k = 0; k < _m; ++k) {
+    _padded[k] *= _chirp_fft[k];
+  }
+  fft_radix2(_padded, true);
+  for (int k = 0; k < _n; ++k) {
+    std::complex<double> x =
+        _chirp[k] * _padded[k] / static_cast<double>(_m);
+    a[k] = inverse ? std::conj(x) : x;
+  }
+}
+
+void CosineTransform::fft_radix2(std::vector<std::complex<double>> &a,
+                                 bool inverse) const {
+  int n = a.size();
+
+  // Bit reversal permutation
+  for (int i = 1, j = 0; i < n; ++i) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(a[i], a[j]);
+    }
+  }
+
+  // Butterflies, with the twiddles of the length _m table
+  for (int len = 2; len <= n; len <<= 1) {
+    int step = _m / len;
+    for (int i = 0; i < n; i += len) {
+      for (int k = 0; k < len / 2; ++k) {
+        std::complex<double> w =
+            inverse ? std::conj(_twiddle[k * step]) : _twiddle[k * step];
+        std::complex<double> u = a[i + k];
+        std::complex<double> v = a[i + k + len / 2] * w;
+        a[i + k] = u + v;
+        a[i + k + len / 2] = u - v;
+      }
+    }
+  }
+}
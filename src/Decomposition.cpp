@@ -0,0 +1,144 @@
+/*
+In this file, we divide the domain into subdomains, uniformly or balancing
+the fluid cells by recursive coordinate bisection, and report the balance.
+*/
+#include "Decomposition.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+Decomposition::Decomposition(const Grid &grid)
+    : _imax(grid.domain().domain_size_x), _jmax(grid.domain().domain_size_y),
+      _prefix((_imax + 1) * (_jmax + 1), 0) {
+    // Fluid cells of the global grid, the offsets being zero unless the grid
+    // is a subdomain itself
+    std::vector<int> fluid((_imax + 1) * (_jmax + 1), 0);
+    for (const Cell *cell : grid.fluid_cells()) {
+        int i = cell->i() + grid.domain().imin;
+        int j = cell->j() + grid.domain().jmin;
+        fluid[i + (_imax + 1) * j] = 1;
+    }
+    for (int j = 1; j < _jmax + 1; ++j) {
+        for (int i = 1; i < _imax + 1; ++i) {
+            int k = i + (_imax + 1) * j;
+            _prefix[k] = fluid[k] + _prefix[k - 1] + _prefix[k - (_imax + 1)] - _prefix[k - 1 - (_imax + 1)];
+        }
+    }
+}
+
+int Decomposition::fluid_cells(const Box &box) const {
+    auto at = [this](int i, int j) { return _prefix[i + (_imax + 1) * j]; };
+    int i0 = box.imin;
+    int j0 = box.jmin;
+    int i1 = box.imin + box.size_x;
+    int j1 = box.jmin + box.size_y;
+    return at(i1, j1) - at(i0, j1) - at(i1, j0) + at(i0, j0);
+}
+
+std::vector<Decomposition::Box> Decomposition::uniform(int iproc, int jproc) const {
+    std::vector<Box> boxes;
+    for (int q = 0; q < jproc; ++q) {
+        int j0 = (_jmax * q) / jproc;
+        int j1 = (_jmax * (q + 1)) / jproc;
+        for (int p = 0; p < iproc; ++p) {
+            int i0 = (_imax * p) / iproc;
+            int i1 = (_imax * (p + 1)) / iproc;
+            boxes.push_back({i0, j0, i1 - i0, j1 - j0});
+        }
+    }
+    return boxes;
+}
+
+std::vector<Decomposition::Box> Decomposition::bisection(int parts) const {
+    std::vector<Box> boxes;
+    bisect({0, 0, _imax, _jmax}, std::max(parts, 1), boxes);
+    return boxes;
+}
+
+// Both directions are tried, and the cut with the smaller load per
+// subdomain on the heavier side wins; on a tie the longer side is cut,
+// which keeps the subdomains compact. Each side keeps at least as many
+// cells as subdomains.
+
+void Decomposition::bisect(const Box &box, int parts, std::vector<Box> &boxes) const {
+    if (parts == 1) {
+        boxes.push_back(box);
+        return;
+    }
+    const int first = parts / 2;
+    const int second = parts - first;
+
+    Box best_low = box;
+    Box best_high = box;
+    double best_load = std::numeric_limits<double>::max();
+    bool x_first = box.size_x >= box.size_y;
+    for (bool along_x : {x_first, not x_first}) {
+        int length = along_x ? box.size_x : box.size_y;
+        int width = along_x ? box.size_y : box.size_x;
+        for (int k = 1; k < length; ++k) {
+            if (k * width < first || (length - k) * width < second) {
+                continue;
+            }
+            Box low = box;
+            Box high = box;
+            if (along_x) {
+                low.size_x = k;
+                high.imin += k;
+                high.size_x -= k;
+            } else {
+                low.size_y = k;
+                high.jmin += k;
+                high.size_y -= k;
+            }
+            double load = std::max(static_cast<double>(fluid_cells(low)) / first,
+                                   static_cast<double>(fluid_cells(high)) / second);
+            // Without fluid, the cut closest to the share of the subdomains
+            if (fluid_cells(box) == 0) {
+                load = std::abs(static_cast<double>(k) / length - static_cast<double>(first) / parts);
+            }
+            if (load < best_load) {
+                best_load = load;
+                best_low = low;
+                best_high = high;
+            }
+        }
+    }
+    bisect(best_low, first, boxes);
+    bisect(best_high, second, boxes);
+}
+
+double Decomposition::imbalance(const std::vector<Box> &boxes) const {
+    int largest = 0;
+    int total = 0;
+    for (const auto &box : boxes) {
+        largest = std::max(largest, fluid_cells(box));
+        total += fluid_cells(box);
+    }
+    return (total > 0) ? static_cast<double>(largest) * boxes.size() / total : 1.0;
+}
+
+void Decomposition::report(std::ostream &out, const std::string &name, const std::vector<Box> &boxes) const {
+    int smallest = std::numeric_limits<int>::max();
+    int largest = 0;
+    int total = 0;
+    int halo = 0;
+    out << name << " decomposition into " << boxes.size() << " subdomains\n";
+    for (size_t rank = 0; rank < boxes.size(); ++rank) {
+        const Box &box = boxes[rank];
+        int fluid = fluid_cells(box);
+        smallest = std::min(smallest, fluid);
+        largest = std::max(largest, fluid);
+        total += fluid;
+        // Faces towards other subdomains, each counted from both sides
+        halo += (box.imin > 0) * box.size_y + (box.imin + box.size_x < _imax) * box.size_y +
+                (box.jmin > 0) * box.size_x + (box.jmin + box.size_y < _jmax) * box.size_x;
+        out << "  rank " << std::setw(4) << rank << ": cells " << std::setw(5) << box.imin + 1 << " - "
+            << std::setw(5) << box.imin + box.size_x << " x " << std::setw(5) << box.jmin + 1 << " - "
+            << std::setw(5) << box.jmin + box.size_y << ", fluid cells " << std::setw(8) << fluid << " of "
+            << std::setw(8) << box.size_x * box.size_y << '\n';
+    }
+    double mean = static_cast<double>(total) / boxes.size();
+    out << "  fluid cells per subdomain: min " << smallest << ", mean " << mean << ", max " << largest
+        << ", imbalance " << imbalance(boxes) << ", halo faces " << halo / 2 << '\n';
+}
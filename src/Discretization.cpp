@@ -1,89 +1,98 @@
 /*
 In this file, we discretize our Navier-Stokes equation in space with finite
-differences We discretize the convection terms; horizontal velocity U, vertical
-velocity V, the diffusion term, laplacian, and the SOR helper function.
+differences: the laplacian and the SOR helper function of the pressure, and
+the factors of the momentum stencils in Stencils.hpp.
 */
 #include "Discretization.hpp"
 
 #include <cmath>
+#include <vector>
 
-double Discretization::_dx = 0.0;
-double Discretization::_dy = 0.0;
-double Discretization::_gamma = 0.0;
-
-Discretization::Discretization(double dx, double dy, double gamma) {
+Discretization::Discretization(const std::vector<double> &dx,
+                               const std::vector<double> &dy, double gamma) {
   _dx = dx;
   _dy = dy;
   _gamma = gamma;
-}
-
-// Calculating the value of convective part of U
-double Discretization::convection_u(const Matrix<double> &U,
-                                    const Matrix<double> &V, int i, int j) {
-  double term1 =
-      (1 / _dx) * (((U(i, j) + U(i + 1, j)) * (U(i, j) + U(i + 1, j)) / 4) -
-                   ((U(i - 1, j) + U(i, j)) * (U(i - 1, j) + U(i, j)) / 4)) +
-      _gamma / (4 * _dx) *
-          (fabs(U(i, j) + U(i + 1, j)) * (U(i, j) - U(i + 1, j)) -
-           fabs(U(i - 1, j) + U(i, j)) * (U(i - 1, j) - U(i, j)));
 
-  double term2 =
-      (1 / (4 * _dy)) *
-          ((V(i, j) + V(i + 1, j)) * (U(i, j) + U(i, j + 1)) -
-           (V(i, j - 1) + V(i + 1, j - 1)) * (U(i, j - 1) + U(i, j))) +
-      _gamma / (4 * _dy) *
-          (fabs(V(i, j) + V(i + 1, j)) * (U(i, j) - U(i, j + 1)) -
-           fabs(V(i, j - 1) + V(i + 1, j - 1)) * (U(i, j - 1) - U(i, j)));
-
-  return term1 + term2;
+  // Distances between the centres of neighbouring cells, i.e. the widths of
+  // the control volumes of the velocities normal to the faces
+  _dx_centres.resize(dx.size() - 1);
+  for (size_t i = 0; i + 1 < dx.size(); i++) {
+    _dx_centres[i] = 0.5 * (dx[i] + dx[i + 1]);
+  }
+  _dy_centres.resize(dy.size() - 1);
+  for (size_t j = 0; j + 1 < dy.size(); j++) {
+    _dy_centres[j] = 0.5 * (dy[j] + dy[j + 1]);
+  }
+
+  // Factors of the specialised momentum stencils
+  StencilCoefficients &c = _coefficients;
+  c.gamma = gamma;
+  c.inv_dx = 1.0 / dx[0];
+  c.inv_dy = 1.0 / dy[0];
+  c.inv_dx2 = c.inv_dx * c.inv_dx;
+  c.inv_dy2 = c.inv_dy * c.inv_dy;
+  for (double width : dx) c.inv_dx_cells.push_back(1.0 / width);
+  for (double width : dy) c.inv_dy_cells.push_back(1.0 / width);
+  for (size_t i = 0; i < _dx_centres.size(); i++) {
+    c.inv_dx_centres.push_back(1.0 / _dx_centres[i]);
+    c.x_weight_low.push_back(dx[i + 1] / (2.0 * _dx_centres[i]));
+    c.x_weight_high.push_back(dx[i] / (2.0 * _dx_centres[i]));
+  }
+  for (size_t j = 0; j < _dy_centres.size(); j++) {
+    c.inv_dy_centres.push_back(1.0 / _dy_centres[j]);
+    c.y_weight_low.push_back(dy[j + 1] / (2.0 * _dy_centres[j]));
+    c.y_weight_high.push_back(dy[j] / (2.0 * _dy_centres[j]));
+  }
 }
 
-// Calculating the value of convective part of V
-
-double Discretization::convection_v(const Matrix<double> &U,
-                                    const Matrix<double> &V, int i, int j) {
-  double term1 =
-      (1 / _dy) * (((V(i, j) + V(i, j + 1)) * (V(i, j) + V(i, j + 1)) / 4) -
-                   ((V(i, j - 1) + V(i, j)) * (V(i, j - 1) + V(i, j)) / 4)) +
-      _gamma / (4 * _dy) *
-          (fabs(V(i, j) + V(i, j + 1)) * (V(i, j) - V(i, j + 1)) -
-           fabs(V(i, j - 1) + V(i, j)) * (V(i, j - 1) - V(i, j)));
-
-  double term2 =
-      (1 / (4 * _dx)) *
-          ((U(i, j) + U(i, j + 1)) * (V(i, j) + V(i + 1, j)) -
-           (U(i - 1, j) + U(i - 1, j + 1)) * (V(i - 1, j) + V(i, j))) +
-      _gamma / (4 * _dx) *
-          (fabs(U(i, j) + U(i, j + 1)) * (V(i, j) - V(i + 1, j)) -
-           fabs(U(i - 1, j) + U(i - 1, j + 1)) * (V(i - 1, j) - V(i, j)));
-
-  return term1 + term2;
+convection_scheme Discretization::scheme() const {
+  if (_gamma == 0.0) return convection_scheme::CENTRAL;
+  if (_gamma == 1.0) return convection_scheme::UPWIND;
+  return convection_scheme::HYBRID;
 }
 
-// Using the same for calculating diffusive part of U and V
-
-double Discretization::diffusion(const Matrix<double> &A, int i, int j) {
-  double term1 = (A(i + 1, j) - 2 * A(i, j) + A(i - 1, j)) / (_dx * _dx);
-  double term2 = (A(i, j + 1) - 2 * A(i, j) + A(i, j - 1)) / (_dy * _dy);
-
-  return term1 + term2;
+grid_spacing Discretization::spacing() const {
+  for (double width : _dx) {
+    if (width != _dx[0]) return grid_spacing::STRETCHED;
+  }
+  for (double width : _dy) {
+    if (width != _dy[0]) return grid_spacing::STRETCHED;
+  }
+  return grid_spacing::UNIFORM;
 }
 
 // Calculating the laplacian part of the equation
 
-double Discretization::laplacian(const Matrix<double> &P, int i, int j) {
-  double result = (P(i + 1, j) - 2.0 * P(i, j) + P(i - 1, j)) / (_dx * _dx) +
-                  (P(i, j + 1) - 2.0 * P(i, j) + P(i, j - 1)) / (_dy * _dy);
-  return result;
+template <typename T>
+T Discretization::laplacian(const Matrix<T> &P, int i, int j) const {
+  return sor_helper(P, i, j) - laplacian_diagonal(i, j) * P(i, j);
 }
 
 // Calculating the SOR Helper
 
-double Discretization::sor_helper(const Matrix<double> &P, int i, int j) {
-  double result = (P(i + 1, j) + P(i - 1, j)) / (_dx * _dx) +
-                  (P(i, j + 1) + P(i, j - 1)) / (_dy * _dy);
+template <typename T>
+T Discretization::sor_helper(const Matrix<T> &P, int i, int j) const {
+  T result = (P(i + 1, j) / _dx_centres[i] +
+                   P(i - 1, j) / _dx_centres[i - 1]) /
+                      _dx[i] +
+                  (P(i, j + 1) / _dy_centres[j] +
+                   P(i, j - 1) / _dy_centres[j - 1]) /
+                      _dy[j];
   return result;
 }
 
+double Discretization::laplacian_diagonal(int i, int j) const {
+  return (1.0 / _dx_centres[i] + 1.0 / _dx_centres[i - 1]) / _dx[i] +
+         (1.0 / _dy_centres[j] + 1.0 / _dy_centres[j - 1]) / _dy[j];
+}
+
 double Discretization::interpolate(const Matrix<double> &A, int i, int j,
-                                   int i_offset, int j_offset) {}
\ No newline at end of file
+                                   int i_offset, int j_offset) const {}
+// Stencils of scalar fields and of batches of cases
+#define INSTANTIATE_STENCILS(T)                                               \
+  template T Discretization::laplacian(const Matrix<T> &, int, int) const;    \
+  template T Discretization::sor_helper(const Matrix<T> &, int, int) const;
+
+INSTANTIATE_STENCILS(double)
+INSTANTIATE_STENCILS(Lanes)
@@ -0,0 +1,133 @@
+/*
+In this file, we read the variants of a parameter study and run them on a
+pool of worker threads, each thread simulating one case at a time.
+*/
+#include "Ensemble.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "BatchedCase.hpp"
+#include "Case.hpp"
+
+Ensemble::Ensemble(std::string case_file, std::string ensemble_file, int threads, bool batch)
+    : _case_file(std::move(case_file)), _threads(threads), _batch(batch) {
+    std::ifstream file(ensemble_file);
+    if (not file.is_open()) {
+        std::cerr << "Ensemble file " << ensemble_file << " could not be opened" << std::endl;
+        return;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        Variant variant;
+        if (not(words >> variant.name) || variant.name[0] == '#') {
+            continue;
+        }
+        std::string key;
+        std::string value;
+        while (words >> key) {
+            if (not(words >> value)) {
+                std::cerr << "Ensemble variant " << variant.name << ": no value for " << key << std::endl;
+                break;
+            }
+            variant.overrides.emplace_back(key, value);
+        }
+        _variants.push_back(std::move(variant));
+    }
+
+    if (_threads <= 0) {
+        _threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+void Ensemble::run() {
+    // A job is one variant, respectively a group of up to batch_width
+    // consecutive variants in batched mode
+    size_t group = _batch ? batch_width : 1;
+    size_t jobs = (_variants.size() + group - 1) / group;
+    int workers = std::min<int>(_threads, jobs);
+    std::cout << "Running " << _variants.size() << " variants on " << workers << " threads";
+    if (_batch) {
+        std::cout << " in batches of up to " << batch_width;
+    }
+    std::cout << std::endl;
+
+    std::atomic<size_t> next{0};
+    std::mutex print_mutex;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        for (size_t job = next++; job < jobs; job = next++) {
+            size_t first = job * group;
+            size_t last = std::min(first + group, _variants.size());
+            auto job_start = std::chrono::steady_clock::now();
+
+            std::vector<std::unique_ptr<Case>> cases;
+            for (size_t k = first; k < last; ++k) {
+                cases.push_back(
+                    std::make_unique<Case>(_case_file, _variants[k].overrides, _variants[k].name, &_grids));
+            }
+
+            // The variants compatible with the first batchable one run
+            // together if they fill enough lanes, the others on their own
+            std::vector<std::unique_ptr<Case>> batch;
+            std::vector<std::unique_ptr<Case>> single;
+            for (auto &problem : cases) {
+                if (batch.empty() ? BatchedCase::compatible(*problem, *problem)
+                                  : BatchedCase::compatible(*batch.front(), *problem)) {
+                    batch.push_back(std::move(problem));
+                } else {
+                    single.push_back(std::move(problem));
+                }
+            }
+            if (batch.size() < BatchedCase::min_cases) {
+                std::move(batch.begin(), batch.end(), std::back_inserter(single));
+                batch.clear();
+            }
+            int batched = batch.size();
+            if (not batch.empty()) {
+                BatchedCase(std::move(batch)).simulate();
+            }
+            for (auto &problem : single) {
+                problem->simulate();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - job_start;
+
+            std::lock_guard<std::mutex> lock(print_mutex);
+            std::cout << "Variant" << (last - first > 1 ? "s " : " ");
+            for (size_t k = first; k < last; ++k) {
+                std::cout << _variants[k].name << (k + 1 < last ? ", " : "");
+            }
+            std::cout << " finished in " << elapsed.count() << " s";
+            if (last - first > 1) {
+                std::cout << ", " << batched << " of them batched";
+            }
+            std::cout << std::endl;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int w = 1; w < workers; ++w) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Ensemble of " << _variants.size() << " variants finished in " << elapsed.count() << " s, "
+              << _grids.size() << " distinct grids" << std::endl;
+}
+
+const std::vector<Variant> &Ensemble::variants() const { return _variants; }
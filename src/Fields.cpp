@@ -8,79 +8,368 @@ the current timestep will be advanced to the next one
 #include <cmath>
 #include <iostream>
 
+#include "Expressions.hpp"
+
+namespace {
+// Thomas algorithm for the tridiagonal system a x_{k-1} + b x_k + c x_{k+1} = d
+// of size n, overwriting c and d; the solution is returned in d
+void solve_tridiagonal(const std::vector<double> &a,
+                       const std::vector<double> &b, std::vector<double> &c,
+                       std::vector<double> &d, int n) {
+  c[0] = c[0] / b[0];
+  d[0] = d[0] / b[0];
+  for (int k = 1; k < n; k++) {
+    double m = 1.0 / (b[k] - a[k] * c[k - 1]);
+    c[k] = c[k] * m;
+    d[k] = (d[k] - a[k] * d[k - 1]) * m;
+  }
+  for (int k = n - 2; k >= 0; k--) {
+    d[k] -= c[k] * d[k + 1];
+  }
+}
+
+// Low-storage Runge-Kutta 3 (Williamson form, coefficients of Wray):
+// Q = alpha Q + dt N, U = U + beta Q, the stages ending at 1/3, 3/4 and 1
+const double rk3_alpha[3] = {0.0, -5.0 / 9.0, -153.0 / 128.0};
+const double rk3_beta[3] = {1.0 / 3.0, 15.0 / 16.0, 8.0 / 15.0};
+const double rk3_fraction[3] = {1.0 / 3.0, 5.0 / 12.0, 1.0 / 4.0};
+
+// Reach of the stability region along the negative real axis relative to
+// explicit Euler, which scales the diffusive timestep limit: AB2 is stable
+// up to half of it, RK3 up to about 1.25 times
+double diffusive_stability(time_integrator integrator) {
+  switch (integrator) {
+    case time_integrator::ADAMS_BASHFORTH_2:
+      return 0.5;
+    case time_integrator::RUNGE_KUTTA_3:
+      return 1.25;
+    default:
+      return 1.0;
+  }
+}
+
+// RMS change per unit time relative to the RMS value, from the sums of
+// squares over the same locations
+double relative_rms(double change2, double value2, double dt) {
+  if (change2 == 0.0) {
+    return 0.0;
+  }
+  return std::sqrt(change2 / value2) / dt;
+}
+}  // namespace
+
 Fields::Fields(double nu, double dt, double tau, int imax, int jmax, double UI,
-               double VI, double PI)
+               double VI, double PI, Arena::Pages pages)
     : _nu(nu), _dt(dt), _tau(tau) {
-  _U = Matrix<double>(imax + 2, jmax + 2,
-                      UI);  // Matrix for velocity along the X-direction
-  _V = Matrix<double>(imax + 2, jmax + 2,
-                      VI);  // Matrix for velocity along the Y-direction
-  _P =
-      Matrix<double>(imax + 2, jmax + 2,
-                     PI);  // Matrix for the pressure values in the cell centers
+  // One arena for the six matrices of every step, first touched by the
+  // thread running the kernels
+  std::size_t bytes = (imax + 2) * (jmax + 2) * sizeof(double);
+  _arena = std::make_shared<Arena>(6 * Arena::piece_size(bytes), pages);
+
+  _U = Matrix<double>(imax + 2, jmax + 2, UI,
+                      _arena);  // Matrix for velocity along the X-direction
+  _V = Matrix<double>(imax + 2, jmax + 2, VI,
+                      _arena);  // Matrix for velocity along the Y-direction
+  _P = Matrix<double>(
+      imax + 2, jmax + 2, PI,
+      _arena);  // Matrix for the pressure values in the cell centers
 
-  _F = Matrix<double>(imax + 2, jmax + 2,
-                      0.0);  // Matrix containing discretized differential data
-  _G =
-      Matrix<double>(imax + 2, jmax + 2,
-                     0.0);  // of the momentum equation for U and V respectively
-  _RS = Matrix<double>(imax + 2, jmax + 2, 0.0);
+  _F = Matrix<double>(imax + 2, jmax + 2, 0.0,
+                      _arena);  // Matrix containing discretized differential data
+  _G = Matrix<double>(
+      imax + 2, jmax + 2, 0.0,
+      _arena);  // of the momentum equation for U and V respectively
+  _RS = Matrix<double>(imax + 2, jmax + 2, 0.0, _arena);
 }
 
-// Calculating differential data for Explicit Euler Scheme
+void Fields::memory_report(std::ostream &out) const {
+  if (_arena) {
+    _arena->report(out);
+  }
+}
 
-void Fields::calculate_fluxes(Grid &grid) {
-  for (int i{1}; i < grid.imax(); i++) {
-    for (int j{1}; j < grid.jmax() + 1; j++) {
-      _F(i, j) = _U(i, j) + _dt * (_nu * Discretization::diffusion(_U, i, j) -
-                                   Discretization::convection_u(_U, _V, i, j));
-    }
+// Calculating differential data for the selected time integrator. The
+// viscous terms are part of the explicit tendency unless they are treated
+// semi-implicitly, then they are added over the stage timestep and corrected
+// in solve_viscous.
+
+void Fields::calculate_fluxes(const Grid &grid, int stage) {
+  _dt_stage = (_time_integrator == time_integrator::RUNGE_KUTTA_3)
+                  ? rk3_fraction[stage] * _dt
+                  : _dt;
+  bool explicit_viscous = (_viscous_scheme == viscous_scheme::EXPLICIT);
+
+  (this->*_momentum_fluxes)(grid, stage, explicit_viscous);
+
+  if (_time_integrator == time_integrator::ADAMS_BASHFORTH_2) {
+    _dt_old = _dt;
   }
 
-  for (int i{1}; i < grid.imax() + 1; i++) {
-    for (int j{1}; j < grid.jmax(); j++) {
-      _G(i, j) = _V(i, j) + _dt * (_nu * Discretization::diffusion(_V, i, j) -
-                                   Discretization::convection_v(_U, _V, i, j));
-    }
+  if (_viscous_scheme != viscous_scheme::EXPLICIT) {
+    solve_viscous(_U, _F, grid.imax() - 1, grid.jmax(), true, grid);
+    solve_viscous(_V, _G, grid.imax(), grid.jmax() - 1, false, grid);
   }
 }
 
-void Fields::calculate_rs(Grid &grid) {
-  int i, j;
-  for (auto cell : grid.fluid_cells()) {
-    i = cell->i();
-    j = cell->j();
-    double term1 = (_F(i, j) - _F(i - 1, j)) / grid.dx();
-    double term2 = (_G(i, j) - _G(i, j - 1)) / grid.dy();
-    _RS(i, j) = (term1 + term2) / _dt;
+// Fluxes F and G with the stencils of one scheme and spacing, instantiated
+// for all of them and selected in set_discretization.
+
+template <convection_scheme S, grid_spacing G>
+void Fields::momentum_fluxes(const Grid &grid, int stage,
+                             bool explicit_viscous) {
+  using Stencil = MomentumStencil<S, G>;
+  const StencilCoefficients &c = _discretization.coefficients();
+
+  grid.for_active_cells(1, grid.imax() - 1, 1, grid.jmax(), [&](int i, int j) {
+    double N = -Stencil::convection_u(c, _U, _V, i, j);
+    double D = _nu * Stencil::diffusion_u(c, _U, i, j);
+    if (_local_dt) {
+      _F(i, j) = local_increment(_U(i, j), N, D, _DTU(i, j),
+                                 (_P(i + 1, j) - _P(i, j)) /
+                                     (0.5 * (grid.dx(i) + grid.dx(i + 1))),
+                                 explicit_viscous);
+    } else if (explicit_viscous) {
+      _F(i, j) = _U(i, j) + increment(D + N, _FN, i, j, stage);
+    } else {
+      _F(i, j) = _U(i, j) + increment(N, _FN, i, j, stage) + _dt_stage * D;
+    }
+  });
+
+  grid.for_active_cells(1, grid.imax(), 1, grid.jmax() - 1, [&](int i, int j) {
+    double N = -Stencil::convection_v(c, _U, _V, i, j);
+    double D = _nu * Stencil::diffusion_v(c, _V, i, j);
+    if (_local_dt) {
+      _G(i, j) = local_increment(_V(i, j), N, D, _DTV(i, j),
+                                 (_P(i, j + 1) - _P(i, j)) /
+                                     (0.5 * (grid.dy(j) + grid.dy(j + 1))),
+                                 explicit_viscous);
+    } else if (explicit_viscous) {
+      _G(i, j) = _V(i, j) + increment(D + N, _GN, i, j, stage);
+    } else {
+      _G(i, j) = _V(i, j) + increment(N, _GN, i, j, stage) + _dt_stage * D;
+    }
+  });
+}
+
+// Pseudo-transient increment with the local timestep dt of the face. The
+// pressure gradient of the previous iteration is included with the local
+// timestep and added back with the global one, which the projection then
+// removes again: the projection only corrects the pressure by the
+// increment phi with laplacian(phi) = div(U*) / dt_global, so that U* - U
+// vanishes exactly in the steady state of the time-accurate equations.
+
+double Fields::local_increment(double A, double N, double D, double dt,
+                               double grad_p, bool explicit_viscous) const {
+  if (explicit_viscous) {
+    return A + dt * (D + N - grad_p) + _dt_stage * grad_p;
   }
+  // The pressure gradient is taken into account by solve_viscous
+  return A + dt * N + dt * D;
 }
 
-// Applying explicit Euler method
+// Semi-implicit viscous terms in delta form: the explicit increment
+// F - U = dt (nu L U - C) is corrected by the approximately factorized
+// (1 - theta dt nu Dxx)(1 - theta dt nu Dyy) (F - U - dt grad p) =
+// dt (nu L U - C - grad p). Including the pressure gradient of the previous
+// time step makes the correction vanish in steady state, which then does not
+// depend on the timestep size.
+
+void Fields::solve_viscous(const Matrix<double> &A, Matrix<double> &F,
+                           int imax, int jmax, bool normal_x, const Grid &grid) {
+  double theta =
+      (_viscous_scheme == viscous_scheme::CRANK_NICOLSON) ? 0.5 : 1.0;
+
+  // Timestep of the increment, local in pseudo-transient mode
+  const Matrix<double> &DT = normal_x ? _DTU : _DTV;
+  auto step = [&](int i, int j) { return _local_dt ? DT(i, j) : _dt_stage; };
 
-void Fields::calculate_velocities(Grid &grid) {
-  for (int i{1}; i < grid.imax(); i++) {
-    for (int j{1}; j < grid.jmax() + 1; j++) {
-      _U(i, j) = _F(i, j) - _dt * (_P(i + 1, j) - _P(i, j)) / grid.dx();
+  // Couplings to the lower and upper neighbour in a direction with the cell
+  // sizes w, for unknowns located at the faces (between the cells n and
+  // n + 1) or at the cell centres
+  auto lower = [](auto w, int n, bool faces) {
+    return faces ? 1.0 / (w(n) * (0.5 * (w(n) + w(n + 1))))
+                 : 1.0 / ((0.5 * (w(n - 1) + w(n))) * w(n));
+  };
+  auto upper = [](auto w, int n, bool faces) {
+    return faces ? 1.0 / (w(n + 1) * (0.5 * (w(n) + w(n + 1))))
+                 : 1.0 / ((0.5 * (w(n) + w(n + 1))) * w(n));
+  };
+  auto wx = [&](int n) { return grid.dx(n); };
+  auto wy = [&](int n) { return grid.dy(n); };
+
+  // Unknowns are the faces between two fluid cells. The face next to a run of
+  // them is either a wall normal to the velocity component, where the
+  // increment vanishes, or lies between two solid cells, where it is the
+  // ghost value reflecting the increment across a tangential wall.
+  int di = normal_x ? 1 : 0;
+  int dj = normal_x ? 0 : 1;
+  auto unknown = [&](int i, int j) {
+    return grid.is_fluid(i, j) && grid.is_fluid(i + di, j + dj);
+  };
+  auto end = [&](int i, int j) {
+    return (grid.is_fluid(i, j) || grid.is_fluid(i + di, j + dj)) ? 0.0 : -1.0;
+  };
+
+  // Pressure gradient at the faces of the velocity component
+  auto grad_p = [&](int i, int j) {
+    return normal_x
+               ? (_P(i + 1, j) - _P(i, j)) / (0.5 * (grid.dx(i) + grid.dx(i + 1)))
+               : (_P(i, j + 1) - _P(i, j)) / (0.5 * (grid.dy(j) + grid.dy(j + 1)));
+  };
+
+  for (int j = 1; j < jmax + 1; j++) {
+    int i = 1;
+    while (i < imax + 1) {
+      if (not unknown(i, j)) {
+        i++;
+        continue;
+      }
+      int first = i;
+      for (; i < imax + 1 && unknown(i, j); i++) {
+        double k = theta * step(i, j) * _nu;
+        double ka = k * lower(wx, i, normal_x);
+        double kc = k * upper(wx, i, normal_x);
+        _line_a[i - first] = -ka;
+        _line_b[i - first] = 1.0 + (ka + kc);
+        _line_c[i - first] = -kc;
+        _line_d[i - first] = F(i, j) - A(i, j) - step(i, j) * grad_p(i, j);
+      }
+      int n = i - first;
+      _line_b[0] += end(first - 1, j) * _line_a[0];
+      _line_b[n - 1] += end(i, j) * _line_c[n - 1];
+      solve_tridiagonal(_line_a, _line_b, _line_c, _line_d, n);
+      // Intermediate increment kept in the flux until the second sweep
+      for (int m = 0; m < n; m++) {
+        F(first + m, j) = _line_d[m];
+      }
     }
   }
 
-  for (int i{1}; i < grid.imax() + 1; i++) {
-    for (int j{1}; j < grid.jmax(); j++) {
-      _V(i, j) = _G(i, j) - _dt * (_P(i, j + 1) - _P(i, j)) / grid.dy();
+  for (int i = 1; i < imax + 1; i++) {
+    int j = 1;
+    while (j < jmax + 1) {
+      // Faces outside of the runs are walls at rest or inside obstacles
+      if (not unknown(i, j)) {
+        F(i, j) = 0.0;
+        j++;
+        continue;
+      }
+      int first = j;
+      for (; j < jmax + 1 && unknown(i, j); j++) {
+        double k = theta * step(i, j) * _nu;
+        double ka = k * lower(wy, j, not normal_x);
+        double kc = k * upper(wy, j, not normal_x);
+        _line_a[j - first] = -ka;
+        _line_b[j - first] = 1.0 + (ka + kc);
+        _line_c[j - first] = -kc;
+        _line_d[j - first] = F(i, j);
+      }
+      int n = j - first;
+      _line_b[0] += end(i, first - 1) * _line_a[0];
+      _line_b[n - 1] += end(i, j) * _line_c[n - 1];
+      solve_tridiagonal(_line_a, _line_b, _line_c, _line_d, n);
+      for (int m = 0; m < n; m++) {
+        int jm = first + m;
+        F(i, jm) = A(i, jm) + _line_d[m] + _dt_stage * grad_p(i, jm);
+      }
     }
   }
 }
 
+void Fields::calculate_rs(const Grid &grid) {
+  using namespace expr;
+  const std::vector<double> &dx = grid.domain().dx_cells;
+  const std::vector<double> &dy = grid.domain().dy_cells;
+  // Only the fluid cells are used by the pressure solvers, the other cells of
+  // the active tiles are computed along in the same row sweeps
+  auto rs = ((at(_F) - at(_F, -1, 0)) / along_x(dx) +
+             (at(_G) - at(_G, 0, -1)) / along_y(dy)) /
+            _dt_stage;
+  grid.for_active_rows(1, grid.imax(), 1, grid.jmax(),
+                       [&](int j, int i0, int i1) {
+                         assign_row(_RS, j, i0, i1, rs);
+                       });
+}
+
+// Projecting the velocities of the current stage. The change monitor sums
+// the squared changes and values before the velocities are overwritten.
+
+void Fields::calculate_velocities(const Grid &grid) {
+  using namespace expr;
+  const std::vector<double> &dx = grid.domain().dx_cells;
+  const std::vector<double> &dy = grid.domain().dy_cells;
+  auto u_new = at(_F) - _dt_stage * (at(_P, 1, 0) - at(_P)) /
+                            (0.5 * (along_x(dx) + along_x(dx, 1)));
+  auto v_new = at(_G) - _dt_stage * (at(_P, 0, 1) - at(_P)) /
+                            (0.5 * (along_y(dy) + along_y(dy, 1)));
+
+  double du2 = 0.0;
+  double u2 = 0.0;
+  double dv2 = 0.0;
+  double v2 = 0.0;
+  if (_monitor_change) {
+    grid.for_active_cells(1, grid.imax() - 1, 1, grid.jmax(), [&](int i, int j) {
+      double u = u_new(i, j);
+      du2 += (u - _U(i, j)) * (u - _U(i, j));
+      u2 += u * u;
+    });
+    grid.for_active_cells(1, grid.imax(), 1, grid.jmax() - 1, [&](int i, int j) {
+      double v = v_new(i, j);
+      dv2 += (v - _V(i, j)) * (v - _V(i, j));
+      v2 += v * v;
+    });
+  }
+  grid.for_active_rows(1, grid.imax() - 1, 1, grid.jmax(),
+                       [&](int j, int i0, int i1) {
+                         assign_row(_U, j, i0, i1, u_new);
+                       });
+  grid.for_active_rows(1, grid.imax(), 1, grid.jmax() - 1,
+                       [&](int j, int i0, int i1) {
+                         assign_row(_V, j, i0, i1, v_new);
+                       });
+
+  if (_monitor_change || _local_dt) {
+    double dp2 = 0.0;
+    double p2 = 0.0;
+    for (auto cell : grid.fluid_cells()) {
+      int i = cell->i();
+      int j = cell->j();
+      if (_local_dt) {
+        // The projection with the global timestep corrects the pressure by
+        // the increment that momentum with the local timesteps needs,
+        // divided by their ratio, so it is relaxed by that ratio
+        double dt = std::max(
+            {_DTU(i - 1, j), _DTU(i, j), _DTV(i, j - 1), _DTV(i, j)});
+        _P(i, j) = _P_old(i, j) + (_P(i, j) - _P_old(i, j)) * (_dt_stage / dt);
+      }
+      dp2 += (_P(i, j) - _P_old(i, j)) * (_P(i, j) - _P_old(i, j));
+      p2 += _P(i, j) * _P(i, j);
+      _P_old(i, j) = _P(i, j);
+    }
+    _change = {relative_rms(du2, u2, _dt_stage),
+               relative_rms(dv2, v2, _dt_stage),
+               relative_rms(dp2, p2, _dt_stage)};
+  }
+}
+
+void Fields::set_change_monitor(bool enabled) {
+  _monitor_change = enabled;
+  _P_old = (enabled || _local_dt) ? _P : Matrix<double>();
+  _change = {0.0, 0.0, 0.0};
+}
+
+const std::array<double, 3> &Fields::relative_change() const { return _change; }
+
 // Calculating dt based on CFL conditions
 
-double Fields::calculate_dt(Grid &grid) {
+double Fields::calculate_dt(const Grid &grid) {
   double CFLu = 0.0;
   double CFLv = 0.0;
   double CFLnu = 0.0;
 
-  double dx2 = grid.dx() * grid.dx();
-  double dy2 = grid.dy() * grid.dy();
+  // The smallest cells limit the timestep size on stretched grids
+  double dx2 = grid.dx_min() * grid.dx_min();
+  double dy2 = grid.dy_min() * grid.dy_min();
 
   double u_max = 0.0;
   double v_max = 0.0;
@@ -93,15 +382,277 @@ double Fields::calculate_dt(Grid &grid) {
     v_max = std::max(v_max, fabs(_V(i, j)));
   }
 
-  CFLu = grid.dx() / u_max;
-  CFLv = grid.dy() / v_max;
-  CFLnu = (0.5 / _nu) * (1.0 / (1.0 / dx2 + 1.0 / dy2));
+  CFLu = grid.dx_min() / u_max;
+  CFLv = grid.dy_min() / v_max;
+  CFLnu = diffusive_stability(_time_integrator) * (0.5 / _nu) *
+          (1.0 / (1.0 / dx2 + 1.0 / dy2));
+
+  if (_viscous_scheme != viscous_scheme::EXPLICIT) {
+    // Only the convective limits remain, which are not defined for a fluid
+    // at rest, keeping the previous timestep size then
+    double CFL = std::min(CFLu, CFLv);
+    if (std::isfinite(CFL)) {
+      _dt = _tau * CFL;
+    }
+    if (_local_dt) {
+      calculate_local_dt(grid);
+    }
+    return _dt;
+  }
 
   _dt = _tau * (std::min({CFLnu, CFLu, CFLv}));
 
+  if (_local_dt) {
+    calculate_local_dt(grid);
+  }
   return _dt;
 }
 
+// Local timesteps from the convective limit at the face and, for explicit
+// viscous terms, the diffusive limit of the adjacent cells. The global
+// timestep is stable everywhere, so it bounds the local ones from below.
+
+void Fields::calculate_local_dt(const Grid &grid) {
+  bool explicit_viscous = (_viscous_scheme == viscous_scheme::EXPLICIT);
+  double diffusive = diffusive_stability(_time_integrator) * 0.5 / _nu;
+  auto limit = [&](double u, double v, double dx, double dy) {
+    double dt = 1.0 / (std::fabs(u) / dx + std::fabs(v) / dy);
+    if (explicit_viscous) {
+      dt = std::min(dt, diffusive / (1.0 / (dx * dx) + 1.0 / (dy * dy)));
+    }
+    return std::min(std::max(_tau * dt, _dt), _local_dt_ratio * _dt);
+  };
+
+  grid.for_active_cells(1, grid.imax() - 1, 1, grid.jmax(), [&](int i, int j) {
+    double v =
+      0.25 * (_V(i, j) + _V(i + 1, j) + _V(i, j - 1) + _V(i + 1, j - 1));
+    _DTU(i, j) = limit(_U(i, j), v, 0.5 * (grid.dx(i) + grid.dx(i + 1)),
+                     grid.dy(j));
+  });
+  grid.for_active_cells(1, grid.imax(), 1, grid.jmax() - 1, [&](int i, int j) {
+    double u =
+      0.25 * (_U(i, j) + _U(i - 1, j) + _U(i, j + 1) + _U(i - 1, j + 1));
+    _DTV(i, j) = limit(u, _V(i, j), grid.dx(i),
+                     0.5 * (grid.dy(j) + grid.dy(j + 1)));
+  });
+}
+
+// Explicit Euler, Adams-Bashforth 2 with variable timestep sizes (starting
+// with an Euler step) and the stages of low-storage Runge-Kutta 3
+
+double Fields::increment(double N, Matrix<double> &stored, int i, int j,
+                         int stage) const {
+  switch (_time_integrator) {
+    case time_integrator::ADAMS_BASHFORTH_2: {
+      double inc = _dt * N;
+      if (_dt_old > 0.0) {
+        double r = _dt / _dt_old;
+        inc = _dt * ((1.0 + 0.5 * r) * N - 0.5 * r * stored(i, j));
+      }
+      stored(i, j) = N;
+      return inc;
+    }
+    case time_integrator::RUNGE_KUTTA_3:
+      stored(i, j) = rk3_alpha[stage] * stored(i, j) + _dt * N;
+      return rk3_beta[stage] * stored(i, j);
+    default:
+      return _dt * N;
+  }
+}
+
+void Fields::set_time_integrator(time_integrator integrator) {
+  _time_integrator = integrator;
+  if (integrator != time_integrator::EULER) {
+    _FN = Matrix<double>(_U.imax(), _U.jmax(), 0.0);
+    _GN = Matrix<double>(_V.imax(), _V.jmax(), 0.0);
+  }
+  _dt_old = 0.0;
+}
+
+int Fields::stages() const {
+  return (_time_integrator == time_integrator::RUNGE_KUTTA_3) ? 3 : 1;
+}
+
+void Fields::set_local_timestepping(double max_ratio) {
+  _local_dt = max_ratio > 0.0;
+  _local_dt_ratio = max_ratio;
+  _DTU = _local_dt ? Matrix<double>(_U.imax(), _U.jmax(), 0.0)
+                   : Matrix<double>();
+  _DTV = _local_dt ? Matrix<double>(_V.imax(), _V.jmax(), 0.0)
+                   : Matrix<double>();
+  _P_old = (_local_dt || _monitor_change) ? _P : Matrix<double>();
+}
+
+void Fields::set_viscous_scheme(viscous_scheme scheme) {
+  _viscous_scheme = scheme;
+  int n = std::max(_U.imax(), _U.jmax());
+  _line_a.assign(n, 0.0);
+  _line_b.assign(n, 0.0);
+  _line_c.assign(n, 0.0);
+  _line_d.assign(n, 0.0);
+}
+
+// Calculating the RMS residual of the pressure poisson equation
+
+double Fields::calculate_residual(const Grid &grid) {
+  double rloc = 0.0;
+
+  // Using squared value of difference to calculate residual
+  for (auto currentCell : grid.fluid_cells()) {
+    int i = currentCell->i();
+    int j = currentCell->j();
+
+    double val = _discretization.laplacian(_P, i, j) - _RS(i, j);
+    rloc += (val * val);
+  }
+
+  return std::sqrt(rloc / grid.fluid_cells().size());
+}
+
+// Derived fields for the output. The corners of the staggered grid lie
+// between two u and two v values each, so the vorticity there is a compact
+// central difference.
+
+void Fields::calculate_vorticity(const Grid &grid,
+                                 Matrix<double> &vorticity) const {
+  vorticity = Matrix<double>(grid.imax() + 1, grid.jmax() + 1, 0.0);
+#pragma omp parallel for schedule(static)
+  for (int j = 0; j < grid.jmax() + 1; j++) {
+    for (int i = 0; i < grid.imax() + 1; i++) {
+      double dvdx = (_V(i + 1, j) - _V(i, j)) /
+                    (0.5 * (grid.dx(i) + grid.dx(i + 1)));
+      double dudy = (_U(i, j + 1) - _U(i, j)) /
+                    (0.5 * (grid.dy(j) + grid.dy(j + 1)));
+      vorticity(i, j) = dvdx - dudy;
+    }
+  }
+}
+
+// The stream function is the solution of laplacian(psi) = -vorticity with
+// the discrete operators of the grid. For discretely divergence free
+// velocities it is found exactly by integrating the face fluxes, v along the
+// bottom and u up every column, in a single pass instead of an iterative
+// Poisson solve; the columns are independent.
+
+void Fields::calculate_stream_function(const Grid &grid,
+                                       Matrix<double> &psi) const {
+  psi = Matrix<double>(grid.imax() + 1, grid.jmax() + 1, 0.0);
+  for (int i = 1; i < grid.imax() + 1; i++) {
+    psi(i, 0) = psi(i - 1, 0) - _V(i, 0) * grid.dx(i);
+  }
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < grid.imax() + 1; i++) {
+    for (int j = 1; j < grid.jmax() + 1; j++) {
+      psi(i, j) = psi(i, j - 1) + _U(i, j) * grid.dy(j);
+    }
+  }
+}
+
+double Fields::calculate_divergence(const Grid &grid,
+                                    Matrix<double> &divergence) const {
+  divergence = Matrix<double>(grid.imaxb(), grid.jmaxb(), 0.0);
+#pragma omp parallel for schedule(static)
+  for (int j = 1; j < grid.jmax() + 1; j++) {
+    for (int i = 1; i < grid.imax() + 1; i++) {
+      divergence(i, j) = (_U(i, j) - _U(i - 1, j)) / grid.dx(i) +
+                         (_V(i, j) - _V(i, j - 1)) / grid.dy(j);
+    }
+  }
+
+  double largest = 0.0;
+  for (auto cell : grid.fluid_cells()) {
+    largest = std::max(largest, std::fabs(divergence(cell->i(), cell->j())));
+  }
+  return largest;
+}
+
+// Keeping a small ring of previous pressure fields to extrapolate the initial
+// guess of the pressure solver from
+
+void Fields::set_pressure_extrapolation(int order) {
+  _P_history.assign(order > 0 ? order + 1 : 0,
+                    Matrix<double>(_P.imax(), _P.jmax(), 0.0));
+  _t_history.assign(_P_history.size(), 0.0);
+  _history_head = -1;
+  _history_count = 0;
+}
+
+void Fields::store_pressure(double t) {
+  if (_P_history.empty()) {
+    return;
+  }
+  _history_head = (_history_head + 1) % _P_history.size();
+  _history_count = std::min<int>(_history_count + 1, _P_history.size());
+
+  Matrix<double> &P_new = _P_history[_history_head];
+  for (int j = 0; j < _P.jmax(); j++) {
+    for (int i = 0; i < _P.imax(); i++) {
+      P_new(i, j) = _P(i, j);
+    }
+  }
+  _t_history[_history_head] = t;
+}
+
+bool Fields::extrapolate_pressure(const Grid &grid, double t) {
+  if (_history_count < 2) {
+    return false;
+  }
+
+  // Lagrange weights of the stored levels, newest first
+  int n = _history_count;
+  int size = _P_history.size();
+  std::vector<int> level(n);
+  std::vector<double> weight(n, 1.0);
+  for (int k = 0; k < n; k++) {
+    level[k] = (_history_head - k + size) % size;
+  }
+  for (int k = 0; k < n; k++) {
+    for (int m = 0; m < n; m++) {
+      if (m != k) {
+        weight[k] *= (t - _t_history[level[m]]) /
+                     (_t_history[level[k]] - _t_history[level[m]]);
+      }
+    }
+  }
+
+  // The pressure is only determined up to a constant, so the mean of the
+  // extrapolated increment over the fluid cells is removed to keep the
+  // pressure level from drifting.
+  const Matrix<double> &P_last = _P_history[level[0]];
+  double mean_increment = 0.0;
+  for (auto cell : grid.fluid_cells()) {
+    int i = cell->i();
+    int j = cell->j();
+    for (int k = 1; k < n; k++) {
+      mean_increment += weight[k] * (_P_history[level[k]](i, j) - P_last(i, j));
+    }
+  }
+  mean_increment /= grid.fluid_cells().size();
+
+  for (int j = 0; j < _P.jmax(); j++) {
+    for (int i = 0; i < _P.imax(); i++) {
+      double p = P_last(i, j) - mean_increment;
+      for (int k = 1; k < n; k++) {
+        p += weight[k] * (_P_history[level[k]](i, j) - P_last(i, j));
+      }
+      _P(i, j) = p;
+    }
+  }
+  return true;
+}
+
+void Fields::restore_pressure() {
+  if (_history_count == 0) {
+    return;
+  }
+  const Matrix<double> &P_last = _P_history[_history_head];
+  for (int j = 0; j < _P.jmax(); j++) {
+    for (int i = 0; i < _P.imax(); i++) {
+      _P(i, j) = P_last(i, j);
+    }
+  }
+}
+
 // Functions to return the corresponding values
 
 double &Fields::p(int i, int j) { return _P(i, j); }
@@ -112,5 +663,35 @@ double &Fields::g(int i, int j) { return _G(i, j); }
 double &Fields::rs(int i, int j) { return _RS(i, j); }
 
 Matrix<double> &Fields::p_matrix() { return _P; }
+Matrix<double> &Fields::u_matrix() { return _U; }
+Matrix<double> &Fields::v_matrix() { return _V; }
 
 double Fields::dt() const { return _dt; }
+
+double Fields::nu() const { return _nu; }
+
+double Fields::tau() const { return _tau; }
+
+void Fields::set_discretization(const Discretization &discretization) {
+  _discretization = discretization;
+
+  // Flux kernels by scheme (central, hybrid, upwind) and spacing (uniform,
+  // stretched)
+  using kernel = void (Fields::*)(const Grid &, int, bool);
+  constexpr auto central = convection_scheme::CENTRAL;
+  constexpr auto hybrid = convection_scheme::HYBRID;
+  constexpr auto upwind = convection_scheme::UPWIND;
+  constexpr auto uniform = grid_spacing::UNIFORM;
+  constexpr auto stretched = grid_spacing::STRETCHED;
+  const kernel kernels[3][2] = {
+      {&Fields::momentum_fluxes<central, uniform>,
+       &Fields::momentum_fluxes<central, stretched>},
+      {&Fields::momentum_fluxes<hybrid, uniform>,
+       &Fields::momentum_fluxes<hybrid, stretched>},
+      {&Fields::momentum_fluxes<upwind, uniform>,
+       &Fields::momentum_fluxes<upwind, stretched>}};
+  _momentum_fluxes = kernels[static_cast<int>(discretization.scheme())]
+                            [static_cast<int>(discretization.spacing())];
+}
+
+const Discretization &Fields::discretization() const { return _discretization; }
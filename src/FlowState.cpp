@@ -0,0 +1,172 @@
+/*
+In this file, we copy the velocities and pressure of a case, interpolate them
+onto another grid and read and write them as binary state files.
+*/
+#include "FlowState.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+namespace {
+/// First line of a state file, followed by the sizes and the values
+const std::string state_header = "fluidchen flow state 1";
+
+/// Locations of the faces 0 to n and of the cell centres 0 to n + 1
+void locations(const std::vector<double> &widths, std::vector<double> &faces, std::vector<double> &centres) {
+    int n = widths.size() - 2;
+    faces.assign(n + 1, 0.0);
+    centres.assign(n + 2, 0.0);
+    centres[0] = -0.5 * widths[0];
+    for (int k = 1; k < n + 2; ++k) {
+        centres[k] = faces[k - 1] + 0.5 * widths[k];
+        if (k < n + 1) {
+            faces[k] = faces[k - 1] + widths[k];
+        }
+    }
+}
+
+/// Lower neighbour k of x in the ascending locations and the weight of k + 1
+void locate(const std::vector<double> &positions, double x, int &k, double &w) {
+    int n = positions.size();
+    k = std::upper_bound(positions.begin(), positions.end(), x) - positions.begin() - 1;
+    k = std::min(std::max(k, 0), n - 2);
+    w = (x - positions[k]) / (positions[k + 1] - positions[k]);
+    w = std::min(std::max(w, 0.0), 1.0);
+}
+
+/// Stencil of a point among the ascending locations of the unknowns
+Stencil stencil(const std::vector<double> &xs, const std::vector<double> &ys, double x, double y) {
+    Stencil s;
+    locate(xs, x, s.i, s.wx);
+    locate(ys, y, s.j, s.wy);
+    return s;
+}
+} // namespace
+
+StaggeredLocations::StaggeredLocations(const std::vector<double> &dx_cells, const std::vector<double> &dy_cells) {
+    locations(dx_cells, _x_faces, _x_centres);
+    locations(dy_cells, _y_faces, _y_centres);
+}
+
+StaggeredLocations::StaggeredLocations(const Grid &grid) {
+    std::vector<double> dx_cells(grid.imaxb());
+    std::vector<double> dy_cells(grid.jmaxb());
+    for (int i = 0; i < grid.imaxb(); ++i) {
+        dx_cells[i] = grid.dx(i);
+    }
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        dy_cells[j] = grid.dy(j);
+    }
+    locations(dx_cells, _x_faces, _x_centres);
+    locations(dy_cells, _y_faces, _y_centres);
+}
+
+// U lives on the x-faces of every row of cells, V on the y-faces of every
+// column and P in the cell centres, ghost cells included
+
+Stencil StaggeredLocations::u(double x, double y) const { return stencil(_x_faces, _y_centres, x, y); }
+
+Stencil StaggeredLocations::v(double x, double y) const { return stencil(_x_centres, _y_faces, x, y); }
+
+Stencil StaggeredLocations::p(double x, double y) const { return stencil(_x_centres, _y_centres, x, y); }
+
+FlowState FlowState::capture(Fields &field, const Grid &grid) {
+    FlowState state;
+    state.imax = grid.imax();
+    state.jmax = grid.jmax();
+    for (int i = 0; i < grid.imaxb(); ++i) {
+        state.dx_cells.push_back(grid.dx(i));
+    }
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        state.dy_cells.push_back(grid.dy(j));
+    }
+    state.U = Matrix<double>(grid.imaxb(), grid.jmaxb());
+    state.V = Matrix<double>(grid.imaxb(), grid.jmaxb());
+    state.P = Matrix<double>(grid.imaxb(), grid.jmaxb());
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        for (int i = 0; i < grid.imaxb(); ++i) {
+            state.U(i, j) = field.u(i, j);
+            state.V(i, j) = field.v(i, j);
+            state.P(i, j) = field.p(i, j);
+        }
+    }
+    return state;
+}
+
+void FlowState::prolongate(Fields &field, const Grid &grid) const {
+    StaggeredLocations source(dx_cells, dy_cells);
+
+    StaggeredLocations target(grid);
+    const auto &xf = target.x_faces();
+    const auto &xc = target.x_centres();
+    const auto &yf = target.y_faces();
+    const auto &yc = target.y_centres();
+
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        for (int i = 0; i < grid.imaxb(); ++i) {
+            if (i < grid.imax() + 1) {
+                field.u(i, j) = source.u(xf[i], yc[j]).apply(U);
+            }
+            if (j < grid.jmax() + 1) {
+                field.v(i, j) = source.v(xc[i], yf[j]).apply(V);
+            }
+            field.p(i, j) = source.p(xc[i], yc[j]).apply(P);
+        }
+    }
+}
+
+bool FlowState::write(const std::string &file_name) const {
+    std::ofstream file(file_name, std::ios::binary);
+    if (not file.is_open()) {
+        std::cerr << "State file " << file_name << " could not be written" << std::endl;
+        return false;
+    }
+    std::int32_t sizes[2] = {imax, jmax};
+    file << state_header << '\n';
+    file.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+    file.write(reinterpret_cast<const char *>(dx_cells.data()), dx_cells.size() * sizeof(double));
+    file.write(reinterpret_cast<const char *>(dy_cells.data()), dy_cells.size() * sizeof(double));
+    for (const Matrix<double> *M : {&U, &V, &P}) {
+        file.write(reinterpret_cast<const char *>(M->data()), M->size() * sizeof(double));
+    }
+    return file.good();
+}
+
+bool FlowState::read(const std::string &file_name, FlowState &state) {
+    std::ifstream file(file_name, std::ios::binary);
+    std::string header;
+    if (not file.is_open() || not std::getline(file, header) || header != state_header) {
+        std::cerr << "State file " << file_name << " could not be read" << std::endl;
+        return false;
+    }
+    std::int32_t sizes[2];
+    file.read(reinterpret_cast<char *>(sizes), sizeof(sizes));
+    if (not file || sizes[0] < 1 || sizes[1] < 1) {
+        std::cerr << "State file " << file_name << " has no valid size" << std::endl;
+        return false;
+    }
+
+    state.imax = sizes[0];
+    state.jmax = sizes[1];
+    state.dx_cells.resize(state.imax + 2);
+    state.dy_cells.resize(state.jmax + 2);
+    file.read(reinterpret_cast<char *>(state.dx_cells.data()), state.dx_cells.size() * sizeof(double));
+    file.read(reinterpret_cast<char *>(state.dy_cells.data()), state.dy_cells.size() * sizeof(double));
+    for (Matrix<double> *M : {&state.U, &state.V, &state.P}) {
+        *M = Matrix<double>(state.imax + 2, state.jmax + 2);
+        std::vector<double> values(M->size());
+        file.read(reinterpret_cast<char *>(values.data()), values.size() * sizeof(double));
+        for (int j = 0; j < state.jmax + 2; ++j) {
+            for (int i = 0; i < state.imax + 2; ++i) {
+                (*M)(i, j) = values[i + (state.imax + 2) * j];
+            }
+        }
+    }
+    if (not file) {
+        std::cerr << "State file " << file_name << " is truncated" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -4,277 +4,335 @@ grid based on where the fluid lies relative to the cell.
 */
 #include "Grid.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
-#include <fstream>
+#include <array>
+#include <functional>
 #include <iostream>
-#include <sstream>
 #include <vector>
 
 #include "Enums.hpp"
 
+namespace {
+// Read-only memory map of a whole file, so large geometry files are parsed
+// without copying them into stream buffers
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &name) {
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0) {
+      void *data =
+          mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        _data = static_cast<const char *>(data);
+        _size = status.st_size;
+        madvise(data, _size, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+  }
+  ~MappedFile() {
+    if (_data != nullptr) {
+      munmap(const_cast<char *>(_data), _size);
+    }
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool valid() const { return _data != nullptr; }
+  const char *begin() const { return _data; }
+  const char *end() const { return _data + _size; }
+
+ private:
+  const char *_data{nullptr};
+  size_t _size{0};
+};
+
+// Skipping whitespace and comments, which run until the end of the line
+const char *skip_separators(const char *p, const char *end) {
+  while (p < end) {
+    if (*p == '#') {
+      while (p < end && *p != '\n') {
+        ++p;
+      }
+    } else if (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') {
+      ++p;
+    } else {
+      break;
+    }
+  }
+  return p;
+}
+
+// Scanning the next unsigned integer, -1 if there is none
+int scan_int(const char *&p, const char *end) {
+  p = skip_separators(p, end);
+  if (p == end || *p < '0' || *p > '9') {
+    return -1;
+  }
+  int value = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    value = 10 * value + (*p - '0');
+    ++p;
+  }
+  return value;
+}
+}  // namespace
+
 Grid::Grid(std::string geom_name, Domain &domain) {
   _domain = domain;
 
-  _cells = Matrix<Cell>(_domain.size_x + 2, _domain.size_y + 2);
-
   if (geom_name.compare("NONE")) {
-    std::vector<std::vector<int>> geometry_data(
-        _domain.domain_size_x + 2,
-        std::vector<int>(_domain.domain_size_y + 2, 0));
-    parse_geometry_file(geom_name, geometry_data);
-    assign_cell_types(geometry_data);
+    if (not parse_geometry_file(geom_name)) {
+      std::cerr << "Using the lid driven cavity instead of the geometry file"
+                << std::endl;
+      build_lid_driven_cavity();
+    }
   } else {
     build_lid_driven_cavity();
   }
 }
 
 void Grid::build_lid_driven_cavity() {
-  std::vector<std::vector<int>> geometry_data(
-      _domain.domain_size_x + 2,
-      std::vector<int>(_domain.domain_size_y + 2, 0));
-
-  for (int i = 0; i < _domain.domain_size_x + 2; ++i) {
-    for (int j = 0; j < _domain.domain_size_y + 2; ++j) {
+  int imax = _domain.domain_size_x + 1;
+  int jmax = _domain.domain_size_y + 1;
+  build_cells([&](int j, std::vector<int> &ids) {
+    for (int i = 0; i < imax + 1; ++i) {
       // Bottom, left and right walls: no-slip
-      if (i == 0 || j == 0 || i == _domain.domain_size_x + 1) {
-        geometry_data.at(i).at(j) = LidDrivenCavity::fixed_wall_id;
+      if (i == 0 || j == 0 || i == imax) {
+        ids[i] = LidDrivenCavity::fixed_wall_id;
       }
       // Top wall: moving wall
-      else if (j == _domain.domain_size_y + 1) {
-        geometry_data.at(i).at(j) = LidDrivenCavity::moving_wall_id;
+      else if (j == jmax) {
+        ids[i] = LidDrivenCavity::moving_wall_id;
+      } else {
+        ids[i] = 0;
       }
     }
-  }
-  assign_cell_types(geometry_data);
+  });
 }
 
-void Grid::assign_cell_types(std::vector<std::vector<int>> &geometry_data) {
-  int i = 0;
-  int j = 0;
-
-  for (int j_geom = _domain.jmin; j_geom < _domain.jmax; ++j_geom) {
-    { i = 0; }
-    for (int i_geom = _domain.imin; i_geom < _domain.imax; ++i_geom) {
-      if (geometry_data.at(i_geom).at(j_geom) == 0) {
-        _cells(i, j) = Cell(i, j, cell_type::FLUID);
-        _fluid_cells.push_back(&_cells(i, j));
-      } else if (geometry_data.at(i_geom).at(j_geom) ==
-                 LidDrivenCavity::moving_wall_id) {
-        _cells(i, j) = Cell(i, j, cell_type::MOVING_WALL,
-                            geometry_data.at(i_geom).at(j_geom));
-        _moving_wall_cells.push_back(&_cells(i, j));
-      } else {
-        if (i == 0 or j == 0 or i == _domain.size_x + 1 or
-            j == _domain.size_y + 1) {
-          // Outer walls
-          _cells(i, j) = Cell(i, j, cell_type::FIXED_WALL,
-                              geometry_data.at(i_geom).at(j_geom));
-          _fixed_wall_cells.push_back(&_cells(i, j));
-        }
-      }
-
-      ++i;
+void Grid::build_cells(
+    const std::function<void(int, std::vector<int> &)> &read_row) {
+  int rows = _domain.size_y + 2;
+  int cols = _domain.size_x + 2;
+
+  // Geometry ids of the subdomain, read row by row in parallel
+  std::vector<int> ids(rows * cols);
+#pragma omp parallel
+  {
+    std::vector<int> row(_domain.domain_size_x + 2);
+#pragma omp for schedule(static)
+    for (int j = 0; j < rows; ++j) {
+      read_row(j + _domain.jmin, row);
+      std::copy(row.begin() + _domain.imin,
+                row.begin() + _domain.imin + cols, ids.begin() + cols * j);
     }
-    ++j;
   }
 
-  // Corner cell neighbour assigment
-  // Bottom-Left Corner
-  i = 0;
-  j = 0;
-  _cells(i, j).set_neighbour(&_cells(i, j + 1), border_position::TOP);
-  _cells(i, j).set_neighbour(&_cells(i + 1, j), border_position::RIGHT);
-  if (_cells(i, j).neighbour(border_position::TOP)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::TOP);
-  }
-  if (_cells(i, j).neighbour(border_position::RIGHT)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::RIGHT);
-  }
-  // Top-Left Corner
-  i = 0;
-  j = _domain.size_y + 1;
-  _cells(i, j).set_neighbour(&_cells(i, j - 1), border_position::BOTTOM);
-  _cells(i, j).set_neighbour(&_cells(i + 1, j), border_position::RIGHT);
-  if (_cells(i, j).neighbour(border_position::BOTTOM)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::BOTTOM);
-  }
-  if (_cells(i, j).neighbour(border_position::RIGHT)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::RIGHT);
-  }
-
-  // Top-Right Corner
-  i = _domain.size_x + 1;
-  j = Grid::_domain.size_y + 1;
-  _cells(i, j).set_neighbour(&_cells(i, j - 1), border_position::BOTTOM);
-  _cells(i, j).set_neighbour(&_cells(i - 1, j), border_position::LEFT);
-  if (_cells(i, j).neighbour(border_position::BOTTOM)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::BOTTOM);
-  }
-  if (_cells(i, j).neighbour(border_position::LEFT)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::LEFT);
-  }
-
-  // Bottom-Right Corner
-  i = Grid::_domain.size_x + 1;
-  j = 0;
-  _cells(i, j).set_neighbour(&_cells(i, j + 1), border_position::TOP);
-  _cells(i, j).set_neighbour(&_cells(i - 1, j), border_position::LEFT);
-  if (_cells(i, j).neighbour(border_position::TOP)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::TOP);
-  }
-  if (_cells(i, j).neighbour(border_position::LEFT)->type() ==
-      cell_type::FLUID) {
-    _cells(i, j).add_border(border_position::LEFT);
-  }
-  // Bottom cells
-  j = 0;
-  for (int i = 1; i < _domain.size_x + 1; ++i) {
-    _cells(i, j).set_neighbour(&_cells(i + 1, j), border_position::RIGHT);
-    _cells(i, j).set_neighbour(&_cells(i - 1, j), border_position::LEFT);
-    _cells(i, j).set_neighbour(&_cells(i, j + 1), border_position::TOP);
-    if (_cells(i, j).neighbour(border_position::RIGHT)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::RIGHT);
-    }
-    if (_cells(i, j).neighbour(border_position::LEFT)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::LEFT);
-    }
-    if (_cells(i, j).neighbour(border_position::TOP)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::TOP);
+  // Active tiles: those with a fluid cell or a neighbour of one
+  _tiles_x = (cols + tile_size - 1) / tile_size;
+  int tiles_y = (rows + tile_size - 1) / tile_size;
+  auto fluid = [&](int i, int j) {
+    return i >= 0 && j >= 0 && i < cols && j < rows && ids[i + cols * j] == 0;
+  };
+  _tile_slot.assign(_tiles_x * tiles_y, -1);
+#pragma omp parallel for schedule(static)
+  for (int t = 0; t < _tiles_x * tiles_y; ++t) {
+    int i0 = (t % _tiles_x) * tile_size;
+    int j0 = (t / _tiles_x) * tile_size;
+    bool active = false;
+    for (int j = j0; j < std::min(j0 + tile_size, rows) && not active; ++j) {
+      for (int i = i0; i < std::min(i0 + tile_size, cols); ++i) {
+        if (fluid(i, j) || fluid(i - 1, j) || fluid(i + 1, j) ||
+            fluid(i, j - 1) || fluid(i, j + 1)) {
+          active = true;
+          break;
+        }
+      }
     }
+    _tile_slot[t] = active ? 0 : -1;
   }
-
-  // Top Cells
-  j = Grid::_domain.size_y + 1;
-
-  for (int i = 1; i < _domain.size_x + 1; ++i) {
-    _cells(i, j).set_neighbour(&_cells(i + 1, j), border_position::RIGHT);
-    _cells(i, j).set_neighbour(&_cells(i - 1, j), border_position::LEFT);
-    _cells(i, j).set_neighbour(&_cells(i, j - 1), border_position::BOTTOM);
-    if (_cells(i, j).neighbour(border_position::RIGHT)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::RIGHT);
-    }
-    if (_cells(i, j).neighbour(border_position::LEFT)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::LEFT);
-    }
-    if (_cells(i, j).neighbour(border_position::BOTTOM)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::BOTTOM);
+  _active_tiles.clear();
+  for (int t = 0; t < _tiles_x * tiles_y; ++t) {
+    if (_tile_slot[t] == 0) {
+      _tile_slot[t] = _active_tiles.size();
+      int i0 = (t % _tiles_x) * tile_size;
+      int j0 = (t / _tiles_x) * tile_size;
+      _active_tiles.push_back({i0, j0, std::min(i0 + tile_size, cols) - 1,
+                               std::min(j0 + tile_size, rows) - 1});
     }
   }
-
-  // Left Cells
-  i = 0;
-  for (int j = 1; j < _domain.size_y + 1; ++j) {
-    _cells(i, j).set_neighbour(&_cells(i + 1, j), border_position::RIGHT);
-    _cells(i, j).set_neighbour(&_cells(i, j - 1), border_position::BOTTOM);
-    _cells(i, j).set_neighbour(&_cells(i, j + 1), border_position::TOP);
-    if (_cells(i, j).neighbour(border_position::RIGHT)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::RIGHT);
-    }
-    if (_cells(i, j).neighbour(border_position::BOTTOM)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::BOTTOM);
-    }
-    if (_cells(i, j).neighbour(border_position::TOP)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::TOP);
+  _cells.assign(_active_tiles.size() * tile_size * tile_size, Cell());
+
+  // Number of fluid, fixed wall and moving wall cells in each row
+  std::vector<std::array<int, 3>> counts(rows, {0, 0, 0});
+
+  // First pass: classification of the cells of the active tiles, row by
+  // row in parallel
+#pragma omp parallel for schedule(static)
+  for (int j = 0; j < rows; ++j) {
+    for (int i = 0; i < cols; ++i) {
+      Cell *cell = cell_at(i, j);
+      if (cell == nullptr) {
+        continue;
+      }
+      int id = ids[i + cols * j];
+      if (id == 0) {
+        *cell = Cell(i, j, cell_type::FLUID);
+        counts[j][0]++;
+      } else if (id == LidDrivenCavity::moving_wall_id) {
+        *cell = Cell(i, j, cell_type::MOVING_WALL, id);
+        counts[j][2]++;
+      } else if (i == 0 or j == 0 or i == cols - 1 or j == rows - 1) {
+        // Outer walls
+        *cell = Cell(i, j, cell_type::FIXED_WALL, id);
+        counts[j][1]++;
+      }
     }
   }
-  // Right Cells
-  i = Grid::_domain.size_x + 1;
-  for (int j = 1; j < _domain.size_y + 1; ++j) {
-    _cells(i, j).set_neighbour(&_cells(i - 1, j), border_position::LEFT);
-    _cells(i, j).set_neighbour(&_cells(i, j - 1), border_position::BOTTOM);
-    _cells(i, j).set_neighbour(&_cells(i, j + 1), border_position::TOP);
-    if (_cells(i, j).neighbour(border_position::LEFT)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::LEFT);
-    }
-    if (_cells(i, j).neighbour(border_position::BOTTOM)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::BOTTOM);
-    }
-    if (_cells(i, j).neighbour(border_position::TOP)->type() ==
-        cell_type::FLUID) {
-      _cells(i, j).add_border(border_position::TOP);
+
+  // Offsets of the rows in the cell containers, which keep the row by row
+  // order of the cells
+  std::vector<std::array<int, 3>> offsets(rows + 1, {0, 0, 0});
+  for (int j = 0; j < rows; ++j) {
+    for (int k = 0; k < 3; ++k) {
+      offsets[j + 1][k] = offsets[j][k] + counts[j][k];
     }
   }
+  _fluid_cells.resize(offsets[rows][0]);
+  _fixed_wall_cells.resize(offsets[rows][1]);
+  _moving_wall_cells.resize(offsets[rows][2]);
+
+  // Second pass: neighbours and borders of all cells in one loop, ghost
+  // cells having no neighbours outside of the grid and cells next to an
+  // inactive tile none in it. Walls border on their fluid neighbours.
+#pragma omp parallel for schedule(static)
+  for (int j = 0; j < rows; ++j) {
+    std::array<int, 3> next = offsets[j];
+    for (int i = 0; i < cols; ++i) {
+      if (cell_at(i, j) == nullptr) {
+        continue;
+      }
+      Cell &cell = *cell_at(i, j);
+      cell.set_neighbour(cell_at(i, j + 1), border_position::TOP);
+      cell.set_neighbour(cell_at(i, j - 1), border_position::BOTTOM);
+      cell.set_neighbour(cell_at(i - 1, j), border_position::LEFT);
+      cell.set_neighbour(cell_at(i + 1, j), border_position::RIGHT);
+
+      switch (cell.type()) {
+        case cell_type::FLUID:
+          _fluid_cells[next[0]++] = &cell;
+          continue;
+        case cell_type::FIXED_WALL:
+          _fixed_wall_cells[next[1]++] = &cell;
+          break;
+        case cell_type::MOVING_WALL:
+          _moving_wall_cells[next[2]++] = &cell;
+          break;
+        default:
+          break;
+      }
 
-  // Inner cells
-  for (int i = 1; i < _domain.size_x + 1; ++i) {
-    for (int j = 1; j < _domain.size_y + 1; ++j) {
-      _cells(i, j).set_neighbour(&_cells(i + 1, j), border_position::RIGHT);
-      _cells(i, j).set_neighbour(&_cells(i - 1, j), border_position::LEFT);
-      _cells(i, j).set_neighbour(&_cells(i, j + 1), border_position::TOP);
-      _cells(i, j).set_neighbour(&_cells(i, j - 1), border_position::BOTTOM);
-
-      if (_cells(i, j).type() != cell_type::FLUID) {
-        if (_cells(i, j).neighbour(border_position::LEFT)->type() ==
-            cell_type::FLUID) {
-          _cells(i, j).add_border(border_position::LEFT);
-        }
-        if (_cells(i, j).neighbour(border_position::RIGHT)->type() ==
-            cell_type::FLUID) {
-          _cells(i, j).add_border(border_position::RIGHT);
-        }
-        if (_cells(i, j).neighbour(border_position::BOTTOM)->type() ==
-            cell_type::FLUID) {
-          _cells(i, j).add_border(border_position::BOTTOM);
-        }
-        if (_cells(i, j).neighbour(border_position::TOP)->type() ==
-            cell_type::FLUID) {
-          _cells(i, j).add_border(border_position::TOP);
+      for (auto position : {border_position::TOP, border_position::BOTTOM,
+                            border_position::LEFT, border_position::RIGHT}) {
+        const Cell *neighbour = cell.neighbour(position);
+        if (neighbour != nullptr && neighbour->type() == cell_type::FLUID) {
+          cell.add_border(position);
         }
       }
     }
   }
 }
 
-void Grid::parse_geometry_file(std::string filedoc,
-                               std::vector<std::vector<int>> &geometry_data) {
-  int numcols, numrows, depth;
-
-  std::ifstream infile(filedoc);
-  std::stringstream ss;
-  std::string inputLine = "";
-
-  // First line : version
-  getline(infile, inputLine);
-  if (inputLine.compare("P2") != 0) {
-    std::cerr << "First line of the PGM file should be P2" << std::endl;
+bool Grid::parse_geometry_file(std::string filedoc) {
+  MappedFile file(filedoc);
+  if (not file.valid()) {
+    std::cerr << "Geometry file " << filedoc << " could not be read"
+              << std::endl;
+    return false;
   }
+  const char *p = file.begin();
+  const char *end = file.end();
 
-  // Second line : comment
-  getline(infile, inputLine);
+  // Magic number: P2 (ASCII) or P5 (binary)
+  if (end - p < 2 || p[0] != 'P' || (p[1] != '2' && p[1] != '5')) {
+    std::cerr << "First line of the PGM file should be P2 or P5" << std::endl;
+    return false;
+  }
+  bool binary = (p[1] == '5');
+  p += 2;
+
+  // Size and depth, possibly preceded by comments
+  int numrows = scan_int(p, end);
+  int numcols = scan_int(p, end);
+  int depth = scan_int(p, end);
+  if (numrows < 0 || numcols < 0 || depth < 0) {
+    std::cerr << "Invalid header of the PGM file " << filedoc << std::endl;
+    return false;
+  }
+  if (numrows != _domain.domain_size_x + 2 ||
+      numcols != _domain.domain_size_y + 2) {
+    std::cerr << "Size of the PGM file " << numrows << " x " << numcols
+              << " does not match the domain including ghost cells "
+              << _domain.domain_size_x + 2 << " x "
+              << _domain.domain_size_y + 2 << std::endl;
+    return false;
+  }
 
-  // Continue with a stringstream
-  ss << infile.rdbuf();
-  // Third line : size
-  ss >> numrows >> numcols;
-  // Fourth line : depth
-  ss >> depth;
+  // Binary data follows a single whitespace, with two bytes per value (most
+  // significant first) for depths above 255
+  int bytes = (depth > 255) ? 2 : 1;
+  if (binary) {
+    ++p;
+    if (end - p < static_cast<long>(numrows) * numcols * bytes) {
+      std::cerr << "PGM file " << filedoc << " is truncated" << std::endl;
+      return false;
+    }
+  }
 
-  // Following lines : data
+  // The data runs from the top row to the bottom row. The start of every row
+  // is located first, so the rows can be classified independently.
+  std::vector<const char *> row_start(numcols);
   for (int col = numcols - 1; col > -1; --col) {
-    for (int row = 0; row < numrows; ++row) {
-      ss >> geometry_data[row][col];
+    row_start[col] = p;
+    if (binary) {
+      p += numrows * bytes;
+    } else {
+      for (int row = 0; row < numrows; ++row) {
+        p = skip_separators(p, end);
+        if (p == end || *p < '0' || *p > '9') {
+          std::cerr << "PGM file " << filedoc << " is truncated" << std::endl;
+          return false;
+        }
+        while (p < end && *p >= '0' && *p <= '9') {
+          ++p;
+        }
+      }
     }
   }
 
-  infile.close();
+  build_cells([&](int col, std::vector<int> &ids) {
+    const char *q = row_start[col];
+    for (int row = 0; row < numrows; ++row) {
+      if (binary) {
+        const unsigned char *byte = reinterpret_cast<const unsigned char *>(q);
+        ids[row] = (bytes == 1) ? byte[0] : (byte[0] << 8) | byte[1];
+        q += bytes;
+      } else {
+        ids[row] = scan_int(q, end);
+      }
+    }
+  });
+  return true;
 }
 
 int Grid::imax() const { return _domain.size_x; }
@@ -283,12 +341,65 @@ int Grid::jmax() const { return _domain.size_y; }
 int Grid::imaxb() const { return _domain.size_x + 2; }
 int Grid::jmaxb() const { return _domain.size_y + 2; }
 
-Cell Grid::cell(int i, int j) const { return _cells(i, j); }
+Cell Grid::cell(int i, int j) const {
+  int index = cell_index(i, j);
+  return (index >= 0) ? _cells[index] : Cell();
+}
+
+bool Grid::is_fluid(int i, int j) const {
+  int index = cell_index(i, j);
+  return index >= 0 && _cells[index].type() == cell_type::FLUID;
+}
+
+int Grid::cell_index(int i, int j) const {
+  if (i < 0 || j < 0 || i >= _domain.size_x + 2 || j >= _domain.size_y + 2) {
+    return -1;
+  }
+  int slot = _tile_slot[i / tile_size + _tiles_x * (j / tile_size)];
+  if (slot < 0) {
+    return -1;
+  }
+  return slot * tile_size * tile_size + (i % tile_size) +
+         tile_size * (j % tile_size);
+}
+
+Cell *Grid::cell_at(int i, int j) {
+  int index = cell_index(i, j);
+  return (index >= 0) ? &_cells[index] : nullptr;
+}
+
+const std::vector<Grid::Tile> &Grid::active_tiles() const {
+  return _active_tiles;
+}
+
+double Grid::active_fraction() const {
+  return static_cast<double>(_active_tiles.size()) / _tile_slot.size();
+}
 
 double Grid::dx() const { return _domain.dx; }
 
 double Grid::dy() const { return _domain.dy; }
 
+double Grid::dx(int i) const { return _domain.dx_cells[i]; }
+
+double Grid::dy(int j) const { return _domain.dy_cells[j]; }
+
+double Grid::dx_min() const {
+  return *std::min_element(_domain.dx_cells.begin(), _domain.dx_cells.end());
+}
+
+double Grid::dy_min() const {
+  return *std::min_element(_domain.dy_cells.begin(), _domain.dy_cells.end());
+}
+
+bool Grid::uniform() const {
+  auto same = [](const std::vector<double> &widths) {
+    return std::all_of(widths.begin(), widths.end(),
+                       [&](double w) { return w == widths.front(); });
+  };
+  return same(_domain.dx_cells) && same(_domain.dy_cells);
+}
+
 const Domain &Grid::domain() const { return _domain; }
 
 const std::vector<Cell *> &Grid::fluid_cells() const { return _fluid_cells; }
@@ -300,3 +411,24 @@ const std::vector<Cell *> &Grid::fixed_wall_cells() const {
 const std::vector<Cell *> &Grid::moving_wall_cells() const {
   return _moving_wall_cells;
 }
+
+std::shared_ptr<const Grid> GridCache::get(const std::string &geom_name,
+                                           Domain &domain) {
+  // Building under the lock keeps cases waiting for a grid that is still
+  // being built from building it a second time
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (const auto &entry : _entries) {
+    if (entry.geom_name == geom_name && entry.dx_cells == domain.dx_cells &&
+        entry.dy_cells == domain.dy_cells) {
+      return entry.grid;
+    }
+  }
+  auto grid = std::make_shared<const Grid>(geom_name, domain);
+  _entries.push_back(Entry{geom_name, domain.dx_cells, domain.dy_cells, grid});
+  return grid;
+}
+
+int GridCache::size() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _entries.size();
+}
@@ -0,0 +1,175 @@
+/*
+In this file, we sample probe points, lines and wall forces every few time
+steps into memory buffers, which are written in chunks as CSV or binary.
+*/
+#include "Monitors.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+namespace {
+/// First line of a binary monitor file, the second one naming the columns
+const std::string monitor_header = "fluidchen monitor 1";
+} // namespace
+
+void Monitors::add_probe(const std::string &name, double x, double y) { add_line(name, x, y, x, y, 1); }
+
+void Monitors::add_line(const std::string &name, double x0, double y0, double x1, double y1, int points) {
+    if (points < 1) {
+        std::cerr << "Monitor " << name << " needs at least one point" << std::endl;
+        return;
+    }
+    Monitor monitor;
+    monitor.name = name;
+    for (int k = 0; k < points; ++k) {
+        double s = (points > 1) ? static_cast<double>(k) / (points - 1) : 0.0;
+        monitor.x.push_back(x0 + s * (x1 - x0));
+        monitor.y.push_back(y0 + s * (y1 - y0));
+    }
+    _monitors.push_back(std::move(monitor));
+}
+
+void Monitors::add_forces(const std::string &name, int wall_id) {
+    Monitor monitor;
+    monitor.name = name;
+    monitor.wall_id = wall_id;
+    _monitors.push_back(std::move(monitor));
+}
+
+bool Monitors::empty() const { return _monitors.empty(); }
+
+std::vector<std::string> Monitors::Monitor::columns() const {
+    if (wall_id >= 0) {
+        return {"drag", "lift"};
+    }
+    std::vector<std::string> names;
+    for (size_t k = 0; k < x.size(); ++k) {
+        std::string suffix = (x.size() > 1) ? std::to_string(k) : "";
+        names.push_back("u" + suffix);
+        names.push_back("v" + suffix);
+        names.push_back("p" + suffix);
+    }
+    return names;
+}
+
+void Monitors::open(const Grid &grid, const std::string &prefix, bool binary, int buffer_size) {
+    _binary = binary;
+    _buffer_size = std::max(buffer_size, 1);
+    StaggeredLocations locations(grid);
+
+    for (auto &monitor : _monitors) {
+        for (size_t k = 0; k < monitor.x.size(); ++k) {
+            monitor.u.push_back(locations.u(monitor.x[k], monitor.y[k]));
+            monitor.v.push_back(locations.v(monitor.x[k], monitor.y[k]));
+            monitor.p.push_back(locations.p(monitor.x[k], monitor.y[k]));
+        }
+        if (monitor.wall_id >= 0) {
+            for (const auto *cells : {&grid.fixed_wall_cells(), &grid.moving_wall_cells()}) {
+                for (const Cell *cell : *cells) {
+                    if (cell->wall_id() == monitor.wall_id && not cell->borders().empty()) {
+                        monitor.walls.push_back(cell);
+                    }
+                }
+            }
+            if (monitor.walls.empty()) {
+                std::cerr << "Monitor " << monitor.name << ": no walls with id " << monitor.wall_id << std::endl;
+            }
+        }
+
+        std::string file_name = prefix + "_" + monitor.name + (_binary ? ".bin" : ".csv");
+        monitor.file.open(file_name, _binary ? std::ios::binary : std::ios::out);
+        if (not monitor.file.is_open()) {
+            std::cerr << "Monitor file " << file_name << " could not be opened" << std::endl;
+            continue;
+        }
+        if (_binary) {
+            monitor.file << monitor_header << '\n';
+        }
+        monitor.file << "step,time";
+        for (const auto &column : monitor.columns()) {
+            monitor.file << ',' << column;
+        }
+        monitor.file << '\n';
+        monitor.file << std::setprecision(10);
+        monitor.buffer.reserve(_buffer_size * (2 + monitor.columns().size()));
+    }
+}
+
+void Monitors::sample(Fields &field, const Grid &grid, int timestep, double t) {
+    const Matrix<double> &U = field.u_matrix();
+    const Matrix<double> &V = field.v_matrix();
+    const Matrix<double> &P = field.p_matrix();
+
+    for (auto &monitor : _monitors) {
+        monitor.buffer.push_back(timestep);
+        monitor.buffer.push_back(t);
+        if (monitor.wall_id >= 0) {
+            double fx;
+            double fy;
+            forces(monitor, field, grid, fx, fy);
+            monitor.buffer.push_back(fx);
+            monitor.buffer.push_back(fy);
+            continue;
+        }
+        for (size_t k = 0; k < monitor.u.size(); ++k) {
+            monitor.buffer.push_back(monitor.u[k].apply(U));
+            monitor.buffer.push_back(monitor.v[k].apply(V));
+            monitor.buffer.push_back(monitor.p[k].apply(P));
+        }
+    }
+
+    if (++_buffered >= _buffer_size) {
+        flush();
+    }
+}
+
+void Monitors::flush() {
+    for (auto &monitor : _monitors) {
+        if (_binary) {
+            monitor.file.write(reinterpret_cast<const char *>(monitor.buffer.data()),
+                               monitor.buffer.size() * sizeof(double));
+        } else {
+            size_t width = 2 + monitor.columns().size();
+            for (size_t k = 0; k < monitor.buffer.size(); ++k) {
+                monitor.file << monitor.buffer[k] << ((k + 1) % width == 0 ? '\n' : ',');
+            }
+        }
+        monitor.file.flush();
+        monitor.buffer.clear();
+    }
+    _buffered = 0;
+}
+
+// Pressure of the adjacent fluid cell on the face and shear from the
+// tangential velocities of the fluid and the ghost cell, which holds the
+// wall velocity in between, with unit density. Walls are pushed away from
+// the fluid and dragged along with it.
+
+void Monitors::forces(const Monitor &monitor, Fields &field, const Grid &grid, double &fx, double &fy) const {
+    fx = 0.0;
+    fy = 0.0;
+    double nu = field.nu();
+    for (const Cell *cell : monitor.walls) {
+        int i = cell->i();
+        int j = cell->j();
+        for (border_position border : cell->borders()) {
+            if (border == border_position::TOP || border == border_position::BOTTOM) {
+                int n = (border == border_position::TOP) ? j + 1 : j - 1;
+                double u_fluid = 0.5 * (field.u(i - 1, n) + field.u(i, n));
+                double u_wall = 0.5 * (field.u(i - 1, j) + field.u(i, j));
+                double distance = 0.5 * (grid.dy(j) + grid.dy(n));
+                fx += nu * (u_fluid - u_wall) / distance * grid.dx(i);
+                fy += (border == border_position::TOP ? -1.0 : 1.0) * field.p(i, n) * grid.dx(i);
+            } else {
+                int n = (border == border_position::RIGHT) ? i + 1 : i - 1;
+                double v_fluid = 0.5 * (field.v(n, j - 1) + field.v(n, j));
+                double v_wall = 0.5 * (field.v(i, j - 1) + field.v(i, j));
+                double distance = 0.5 * (grid.dx(i) + grid.dx(n));
+                fy += nu * (v_fluid - v_wall) / distance * grid.dy(j);
+                fx += (border == border_position::RIGHT ? -1.0 : 1.0) * field.p(n, j) * grid.dy(j);
+            }
+        }
+    }
+}
@@ -7,45 +7,145 @@ the solution is converging or not.
 #include <cmath>
 #include <iostream>
 
-SOR::SOR(double omega) : _omega(omega) {}
+SOR::SOR(double omega, bool adaptive, std::ostream *out)
+    : _omega(omega), _adaptive(adaptive), _out(out) {}
 
-double SOR::solve(Fields &field, Grid &grid,
+double SOR::solve(Fields &field, const Grid &grid,
                   const std::vector<std::unique_ptr<Boundary>> &boundaries) {
-  double dx = grid.dx();
-  double dy = grid.dy();
-
-  double coeff =
-      _omega /
-      (2.0 * (1.0 / (dx * dx) +
-              1.0 / (dy * dy)));  // = _omega * h^2 / 4.0, if dx == dy == h
-
+  const Discretization &discretization = field.discretization();
   for (auto currentCell : grid.fluid_cells()) {
     int i = currentCell->i();
     int j = currentCell->j();
 
+    // = _omega * h^2 / 4.0, if dx == dy == h
+    double coeff = _omega / discretization.laplacian_diagonal(i, j);
+
     field.p(i, j) =
         (1.0 - _omega) * field.p(i, j) +
-        coeff * (Discretization::sor_helper(field.p_matrix(), i, j) -
+        coeff * (discretization.sor_helper(field.p_matrix(), i, j) -
                  field.rs(i, j));
   }
 
-  double res = 0.0;
-  double rloc = 0.0;
+  // Only the pressure ghost values follow the interior, the velocity
+  // conditions are applied once per time step in Case::simulate
+  for (auto &boundary : boundaries) {
+    boundary->apply_pressure(field);
+  }
 
-  // Using squared value of difference to calculate residual
+  // RMS residual over the fluid cells
+  double res = field.calculate_residual(grid);
+  if (_adaptive) {
+    _residuals.push_back(res);
+  }
 
-  for (auto currentCell : grid.fluid_cells()) {
-    int i = currentCell->i();
-    int j = currentCell->j();
+  return res;
+}
+
+void SOR::start_timestep() {
+  // Only time steps with enough sweeps show the asymptotic contraction, the
+  // first half of the sweeps is dominated by the fast decaying modes
+  const int min_sweeps = 10;
+  int sweeps = _residuals.size();
+  if (sweeps >= min_sweeps && _residuals.back() > 0.0) {
+    int first = sweeps / 2;
+    double lambda = std::pow(_residuals.back() / _residuals[first],
+                             1.0 / (sweeps - 1 - first));
+
+    // For lambda <= omega - 1 the relaxation factor is already above the
+    // optimum and the contraction carries no information about mu
+    if (lambda < 1.0 && lambda > _omega - 1.0) {
+      double mu2 = (lambda + _omega - 1.0) * (lambda + _omega - 1.0) /
+                   (lambda * _omega * _omega);
+      if (mu2 < 1.0) {
+        double omega =
+            std::min(2.0 / (1.0 + std::sqrt(1.0 - mu2)), _omega_max);
+        if (std::fabs(omega - _omega) > 1e-3) {
+          _omega = omega;
+          if (_out != nullptr) {
+            *_out << "SOR relaxation factor adapted to " << _omega << '\n';
+          }
+        }
+      }
+    }
+  }
+  _residuals.clear();
+}
+
+double SOR::omega() const { return _omega; }
+
+FastPoissonSolver::FastPoissonSolver(const Grid &grid)
+    : _transform_x(grid.imax()),
+      _transform_y(grid.jmax()),
+      _lambda_x(grid.imax()),
+      _lambda_y(grid.jmax()),
+      _work(grid.imax() * grid.jmax()) {
+  const double pi = std::acos(-1.0);
+  double dx = grid.dx();
+  double dy = grid.dy();
 
-    double val =
-        Discretization::laplacian(field.p_matrix(), i, j) - field.rs(i, j);
-    rloc += (val * val);
+  // Eigenvalues of the Neumann second difference, cos(pi k (i + 1/2) / n)
+  // being the eigenvectors
+  for (int k = 0; k < grid.imax(); ++k) {
+    _lambda_x[k] = (2.0 * std::cos(pi * k / grid.imax()) - 2.0) / (dx * dx);
   }
-  {
-    res = rloc / (grid.fluid_cells().size());
-    res = std::sqrt(res);
+  for (int k = 0; k < grid.jmax(); ++k) {
+    _lambda_y[k] = (2.0 * std::cos(pi * k / grid.jmax()) - 2.0) / (dy * dy);
   }
+}
 
-  return res;
+bool FastPoissonSolver::applicable(const Grid &grid) {
+  return grid.uniform() && grid.fluid_cells().size() ==
+                               static_cast<size_t>(grid.imax()) * grid.jmax();
+}
+
+double FastPoissonSolver::solve(
+    Fields &field, const Grid &grid,
+    const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+  int imax = grid.imax();
+  int jmax = grid.jmax();
+
+  for (int j = 1; j < jmax + 1; ++j) {
+    for (int i = 1; i < imax + 1; ++i) {
+      _work[(i - 1) + (j - 1) * imax] = field.rs(i, j);
+    }
+  }
+
+  // Rows are contiguous, columns have the stride of a row
+  for (int j = 0; j < jmax; ++j) {
+    _transform_x.forward(&_work[j * imax]);
+  }
+  for (int i = 0; i < imax; ++i) {
+    _transform_y.forward(&_work[i], imax);
+  }
+
+  for (int j = 0; j < jmax; ++j) {
+    for (int i = 0; i < imax; ++i) {
+      double lambda = _lambda_x[i] + _lambda_y[j];
+      // The constant mode is undetermined, fixing the mean pressure to zero
+      _work[i + j * imax] = (i == 0 && j == 0) ? 0.0 : _work[i + j * imax] / lambda;
+    }
+  }
+
+  for (int i = 0; i < imax; ++i) {
+    _transform_y.backward(&_work[i], imax);
+  }
+  for (int j = 0; j < jmax; ++j) {
+    _transform_x.backward(&_work[j * imax]);
+  }
+
+  for (int j = 1; j < jmax + 1; ++j) {
+    for (int i = 1; i < imax + 1; ++i) {
+      field.p(i, j) = _work[(i - 1) + (j - 1) * imax];
+    }
+  }
+
+  // Only the pressure ghost values follow the interior, the velocity
+  // conditions are applied once per time step in Case::simulate
+  for (auto &boundary : boundaries) {
+    boundary->apply_pressure(field);
+  }
+
+  return field.calculate_residual(grid);
 }
+
+void FastPoissonSolver::start_timestep() {}
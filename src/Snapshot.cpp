@@ -0,0 +1,390 @@
+/*
+In this file, we compress snapshots of the flow with zlib, losslessly after a
+byte shuffle or quantized to an error bound with predictive coding, and
+convert them back to VTK files.
+*/
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <zlib.h>
+
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkStructuredGrid.h>
+#include <vtkStructuredGridWriter.h>
+
+namespace {
+/// First line of a snapshot file, followed by the header and the quantities
+const std::string snapshot_header = "fluidchen snapshot 1";
+
+/// Coding of a quantity
+enum Method : std::uint8_t { shuffled = 0, quantized = 1 };
+
+/// Largest quantized value, well inside the exactly representable integers
+const double quantized_limit = 1125899906842624.0;  // 2^50
+
+struct Header {
+    std::int32_t imax;
+    std::int32_t jmax;
+    std::int32_t timestep;
+    /// Time step of the snapshot a delta encoded one refers to, -1 for keyframes
+    std::int32_t reference;
+    double t;
+    double tolerance;
+};
+
+bool read_header(std::istream &file, Header &header) {
+    std::string line;
+    if (not std::getline(file, line) || line != snapshot_header) {
+        return false;
+    }
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    return file && header.imax > 0 && header.jmax > 0;
+}
+
+std::uint64_t bits(double x) {
+    std::uint64_t b;
+    std::memcpy(&b, &x, sizeof(b));
+    return b;
+}
+
+double value(std::uint64_t b) {
+    double x;
+    std::memcpy(&x, &b, sizeof(x));
+    return x;
+}
+
+std::uint64_t zigzag(std::int64_t r) { return (static_cast<std::uint64_t>(r) << 1) ^ static_cast<std::uint64_t>(r >> 63); }
+
+std::int64_t unzigzag(std::uint64_t z) { return static_cast<std::int64_t>(z >> 1) ^ -static_cast<std::int64_t>(z & 1); }
+
+/// Whether all values can be quantized with the step
+bool quantizable(const std::vector<double> &values, double step) {
+    return std::all_of(values.begin(), values.end(),
+                       [step](double x) { return std::isfinite(x) && std::abs(x / step) < quantized_limit; });
+}
+
+// The Lorenzo predictor of a value is the sum of its left and lower
+// neighbours minus the lower left one, exact for bilinear fields; values
+// outside of the matrix are zero.
+
+void lorenzo_residuals(std::vector<std::int64_t> &q, int nx) {
+    int ny = q.size() / nx;
+    for (int j = ny - 1; j >= 0; --j) {
+        for (int i = nx - 1; i >= 0; --i) {
+            std::int64_t left = (i > 0) ? q[i - 1 + nx * j] : 0;
+            std::int64_t below = (j > 0) ? q[i + nx * (j - 1)] : 0;
+            std::int64_t corner = (i > 0 && j > 0) ? q[i - 1 + nx * (j - 1)] : 0;
+            q[i + nx * j] -= left + below - corner;
+        }
+    }
+}
+
+void lorenzo_values(std::vector<std::int64_t> &q, int nx) {
+    int ny = q.size() / nx;
+    for (int j = 0; j < ny; ++j) {
+        for (int i = 0; i < nx; ++i) {
+            std::int64_t left = (i > 0) ? q[i - 1 + nx * j] : 0;
+            std::int64_t below = (j > 0) ? q[i + nx * (j - 1)] : 0;
+            std::int64_t corner = (i > 0 && j > 0) ? q[i - 1 + nx * (j - 1)] : 0;
+            q[i + nx * j] += left + below - corner;
+        }
+    }
+}
+
+std::vector<double> values_of(const Matrix<double> &M) { return std::vector<double>(M.data(), M.data() + M.size()); }
+
+Matrix<double> matrix_of(const std::vector<double> &values, int nx, int ny) {
+    Matrix<double> M(nx, ny);
+    for (int j = 0; j < ny; ++j) {
+        for (int i = 0; i < nx; ++i) {
+            M(i, j) = values[i + nx * j];
+        }
+    }
+    return M;
+}
+} // namespace
+
+SnapshotCodec::SnapshotCodec(bool lossy, double tolerance, int keyframe_interval)
+    : _lossy(lossy), _tolerance(tolerance), _keyframe_interval(std::max(keyframe_interval, 1)) {}
+
+bool SnapshotCodec::write(const std::string &file_name, const FlowState &state, int timestep, double t) {
+    std::ofstream file(file_name, std::ios::binary);
+    if (not file.is_open()) {
+        std::cerr << "Snapshot file " << file_name << " could not be written" << std::endl;
+        return false;
+    }
+
+    bool delta = _previous_step >= 0 && _since_keyframe < _keyframe_interval &&
+                 _previous[0].size() == static_cast<size_t>(state.U.size());
+    if (not delta) {
+        _since_keyframe = 0;
+    }
+    Header header{state.imax, state.jmax, timestep, delta ? _previous_step : -1, t, _lossy ? _tolerance : 0.0};
+    file << snapshot_header << '\n';
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(state.dx_cells.data()), state.dx_cells.size() * sizeof(double));
+    file.write(reinterpret_cast<const char *>(state.dy_cells.data()), state.dy_cells.size() * sizeof(double));
+
+    int q = 0;
+    for (const Matrix<double> *M : {&state.U, &state.V, &state.P}) {
+        std::vector<double> values = values_of(*M);
+        std::string buffer;
+        encode(values, delta ? &_previous[q] : nullptr, state.imax + 2, buffer);
+        file.write(buffer.data(), buffer.size());
+        _previous[q++] = std::move(values);
+    }
+    _previous_step = timestep;
+    _since_keyframe++;
+    return file.good();
+}
+
+// A quantity is stored as its method, the sizes of the compressed and of the
+// uncompressed data and the compressed data. Encoding replaces the values by
+// the ones the reader reconstructs.
+
+void SnapshotCodec::encode(std::vector<double> &values, const std::vector<double> *previous, int nx,
+                           std::string &buffer) const {
+    const double step = 2.0 * _tolerance;
+    const size_t n = values.size();
+    std::uint8_t method = shuffled;
+    if (_lossy && _tolerance > 0.0 && quantizable(values, step) && (not previous || quantizable(*previous, step))) {
+        method = quantized;
+    }
+
+    std::string raw;
+    if (method == quantized) {
+        std::vector<std::int64_t> q(n);
+        for (size_t k = 0; k < n; ++k) {
+            q[k] = std::llround(values[k] / step);
+            values[k] = q[k] * step;
+            if (previous) {
+                q[k] -= std::llround((*previous)[k] / step);
+            }
+        }
+        lorenzo_residuals(q, nx);
+        raw.reserve(2 * n);
+        for (std::int64_t r : q) {
+            std::uint64_t z = zigzag(r);
+            while (z >= 0x80) {
+                raw.push_back(static_cast<char>((z & 0x7f) | 0x80));
+                z >>= 7;
+            }
+            raw.push_back(static_cast<char>(z));
+        }
+    } else {
+        raw.resize(n * sizeof(double));
+        for (size_t k = 0; k < n; ++k) {
+            std::uint64_t b = bits(values[k]) ^ (previous ? bits((*previous)[k]) : 0);
+            for (size_t byte = 0; byte < sizeof(double); ++byte) {
+                raw[byte * n + k] = static_cast<char>(b >> (8 * byte));
+            }
+        }
+    }
+
+    uLongf compressed_size = compressBound(raw.size());
+    std::string compressed(compressed_size, '\0');
+    compress2(reinterpret_cast<Bytef *>(&compressed[0]), &compressed_size,
+              reinterpret_cast<const Bytef *>(raw.data()), raw.size(), Z_DEFAULT_COMPRESSION);
+    std::uint64_t sizes[2] = {compressed_size, raw.size()};
+    buffer.push_back(static_cast<char>(method));
+    buffer.append(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+    buffer.append(compressed.data(), compressed_size);
+}
+
+bool SnapshotCodec::read(const std::string &file_name, FlowState &state, int &timestep, double &t) {
+    std::ifstream file(file_name, std::ios::binary);
+    Header header;
+    if (not file.is_open() || not read_header(file, header)) {
+        std::cerr << "Snapshot file " << file_name << " could not be read" << std::endl;
+        return false;
+    }
+    const size_t n = static_cast<size_t>(header.imax + 2) * (header.jmax + 2);
+    bool delta = header.reference >= 0;
+    if (delta && (header.reference != _previous_step || _previous[0].size() != n)) {
+        std::cerr << "Snapshot file " << file_name << " refers to time step " << header.reference
+                  << ", which has not been read before" << std::endl;
+        return false;
+    }
+
+    state.imax = header.imax;
+    state.jmax = header.jmax;
+    state.dx_cells.resize(state.imax + 2);
+    state.dy_cells.resize(state.jmax + 2);
+    file.read(reinterpret_cast<char *>(state.dx_cells.data()), state.dx_cells.size() * sizeof(double));
+    file.read(reinterpret_cast<char *>(state.dy_cells.data()), state.dy_cells.size() * sizeof(double));
+
+    _tolerance = header.tolerance;
+    std::vector<double> values[3];
+    for (int q = 0; q < 3; ++q) {
+        values[q].resize(n);
+        if (not decode(file, delta ? &_previous[q] : nullptr, header.imax + 2, values[q])) {
+            std::cerr << "Snapshot file " << file_name << " is truncated or corrupt" << std::endl;
+            return false;
+        }
+    }
+    state.U = matrix_of(values[0], header.imax + 2, header.jmax + 2);
+    state.V = matrix_of(values[1], header.imax + 2, header.jmax + 2);
+    state.P = matrix_of(values[2], header.imax + 2, header.jmax + 2);
+    for (int q = 0; q < 3; ++q) {
+        _previous[q] = std::move(values[q]);
+    }
+    _previous_step = header.timestep;
+    timestep = header.timestep;
+    t = header.t;
+    return true;
+}
+
+bool SnapshotCodec::decode(std::istream &file, const std::vector<double> *previous, int nx,
+                           std::vector<double> &values) const {
+    const size_t n = values.size();
+    std::uint8_t method;
+    std::uint64_t sizes[2];
+    file.read(reinterpret_cast<char *>(&method), sizeof(method));
+    file.read(reinterpret_cast<char *>(sizes), sizeof(sizes));
+    if (not file || (method == shuffled && sizes[1] != n * sizeof(double)) || sizes[1] > 10 * n * sizeof(double)) {
+        return false;
+    }
+    std::string compressed(sizes[0], '\0');
+    file.read(&compressed[0], sizes[0]);
+    std::string raw(sizes[1], '\0');
+    uLongf raw_size = sizes[1];
+    if (not file || uncompress(reinterpret_cast<Bytef *>(&raw[0]), &raw_size,
+                               reinterpret_cast<const Bytef *>(compressed.data()), sizes[0]) != Z_OK ||
+        raw_size != sizes[1]) {
+        return false;
+    }
+
+    if (method == quantized) {
+        const double step = 2.0 * _tolerance;
+        std::vector<std::int64_t> q(n);
+        size_t pos = 0;
+        for (size_t k = 0; k < n; ++k) {
+            std::uint64_t z = 0;
+            for (int shift = 0;; shift += 7) {
+                if (pos >= raw.size() || shift > 63) {
+                    return false;
+                }
+                std::uint8_t byte = raw[pos++];
+                z |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (byte < 0x80) {
+                    break;
+                }
+            }
+            q[k] = unzigzag(z);
+        }
+        lorenzo_values(q, nx);
+        for (size_t k = 0; k < n; ++k) {
+            if (previous) {
+                q[k] += std::llround((*previous)[k] / step);
+            }
+            values[k] = q[k] * step;
+        }
+    } else if (method == shuffled) {
+        for (size_t k = 0; k < n; ++k) {
+            std::uint64_t b = 0;
+            for (size_t byte = 0; byte < sizeof(double); ++byte) {
+                b |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(raw[byte * n + k])) << (8 * byte);
+            }
+            values[k] = value(b ^ (previous ? bits((*previous)[k]) : 0));
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Same points and interpolation as Case::output_vtk
+
+void SnapshotCodec::write_vtk(const FlowState &state, const std::string &file_name) {
+    const auto &dx = state.dx_cells;
+    const auto &dy = state.dy_cells;
+    vtkSmartPointer<vtkStructuredGrid> structuredGrid = vtkSmartPointer<vtkStructuredGrid>::New();
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    double y = dy[0];
+    for (int j = 0; j < state.jmax + 1; ++j) {
+        double x = dx[0];
+        for (int i = 0; i < state.imax + 1; ++i) {
+            points->InsertNextPoint(x, y, 0.0);
+            x += dx[i + 1];
+        }
+        y += dy[j + 1];
+    }
+    structuredGrid->SetDimensions(state.imax + 1, state.jmax + 1, 1);
+    structuredGrid->SetPoints(points);
+
+    vtkDoubleArray *Pressure = vtkDoubleArray::New();
+    Pressure->SetName("pressure");
+    Pressure->SetNumberOfComponents(1);
+    for (int j = 1; j < state.jmax + 1; ++j) {
+        for (int i = 1; i < state.imax + 1; ++i) {
+            double pressure = state.P(i, j);
+            Pressure->InsertNextTuple(&pressure);
+        }
+    }
+
+    vtkDoubleArray *Velocity = vtkDoubleArray::New();
+    Velocity->SetName("velocity");
+    Velocity->SetNumberOfComponents(3);
+    float vel[3];
+    vel[2] = 0;
+    for (int j = 0; j < state.jmax + 1; ++j) {
+        for (int i = 0; i < state.imax + 1; ++i) {
+            vel[0] = (dy[j + 1] * state.U(i, j) + dy[j] * state.U(i, j + 1)) / (dy[j] + dy[j + 1]);
+            vel[1] = (dx[i + 1] * state.V(i, j) + dx[i] * state.V(i + 1, j)) / (dx[i] + dx[i + 1]);
+            Velocity->InsertNextTuple(vel);
+        }
+    }
+    structuredGrid->GetCellData()->AddArray(Pressure);
+    structuredGrid->GetPointData()->AddArray(Velocity);
+
+    vtkSmartPointer<vtkStructuredGridWriter> writer = vtkSmartPointer<vtkStructuredGridWriter>::New();
+    writer->SetFileName(file_name.c_str());
+    writer->SetInputData(structuredGrid);
+    writer->Write();
+}
+
+int SnapshotCodec::convert(std::vector<std::string> file_names) {
+    // Sorted by time step, unreadable files first to be reported
+    auto step = [](const std::string &file_name) {
+        std::ifstream file(file_name, std::ios::binary);
+        Header header;
+        return read_header(file, header) ? header.timestep : -1;
+    };
+    std::vector<std::pair<int, std::string>> files;
+    for (const auto &file_name : file_names) {
+        files.emplace_back(step(file_name), file_name);
+    }
+    std::stable_sort(files.begin(), files.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    SnapshotCodec codec;
+    int failed = 0;
+    for (const auto &file : files) {
+        FlowState state;
+        int timestep;
+        double t;
+        if (not codec.read(file.second, state, timestep, t)) {
+            failed++;
+            continue;
+        }
+        std::string vtk_name = file.second;
+        size_t dot = vtk_name.rfind('.');
+        if (dot != std::string::npos && vtk_name.find('/', dot) == std::string::npos) {
+            vtk_name.erase(dot);
+        }
+        vtk_name += ".vtk";
+        write_vtk(state, vtk_name);
+        std::cout << file.second << " (time step " << timestep << ", time " << t << ") -> " << vtk_name
+                  << std::endl;
+    }
+    return failed;
+}
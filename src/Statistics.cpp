@@ -0,0 +1,106 @@
+/*
+In this file, we accumulate time weighted running statistics of the flow in
+the cell centres with Welford's algorithm.
+*/
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Statistics::Statistics(int imax, int jmax, bool stresses) : _imax(imax), _jmax(jmax), _stresses(stresses) {
+    int cells = imax * jmax;
+    for (auto &moments : _moments) {
+        moments.mean.assign(cells, 0.0);
+        moments.m2.assign(cells, 0.0);
+        moments.min.assign(cells, std::numeric_limits<double>::max());
+        moments.max.assign(cells, std::numeric_limits<double>::lowest());
+    }
+    if (stresses) {
+        _cuv.assign(cells, 0.0);
+    }
+    for (auto &row : _row) {
+        row.assign(imax, 0.0);
+    }
+}
+
+// With the weight w of the sample and the accumulated weight W including it,
+// the mean moves by w / W of the deviation d from the old mean and the sum
+// of the weighted squared deviations grows by w d (x - new mean). The
+// co-moment grows by w d_u (v - new mean of v) = w (1 - w / W) d_u d_v.
+
+void Statistics::accumulate(Fields &field, const Grid &grid, double weight) {
+    if (weight <= 0.0) {
+        return;
+    }
+    _samples++;
+    _weight += weight;
+    const double f = weight / _weight;
+
+    const Matrix<double> &u_matrix = field.u_matrix();
+    const Matrix<double> &v_matrix = field.v_matrix();
+    const Matrix<double> &p_matrix = field.p_matrix();
+    const int stride = grid.imaxb();
+
+    for (int j = 1; j < _jmax + 1; ++j) {
+        const double *u = u_matrix.data() + stride * j;
+        const double *v = v_matrix.data() + stride * j;
+        const double *v_below = v_matrix.data() + stride * (j - 1);
+        const double *p = p_matrix.data() + stride * j;
+        double *row_u = _row[U].data();
+        double *row_v = _row[V].data();
+        double *row_p = _row[P].data();
+        for (int i = 0; i < _imax; ++i) {
+            row_u[i] = 0.5 * (u[i] + u[i + 1]);
+            row_v[i] = 0.5 * (v_below[i + 1] + v[i + 1]);
+            row_p[i] = p[i + 1];
+        }
+
+        const int offset = index(1, j);
+        if (_stresses) {
+            const double *mean_u = _moments[U].mean.data() + offset;
+            const double *mean_v = _moments[V].mean.data() + offset;
+            double *cuv = _cuv.data() + offset;
+            for (int i = 0; i < _imax; ++i) {
+                cuv[i] += weight * (1.0 - f) * (row_u[i] - mean_u[i]) * (row_v[i] - mean_v[i]);
+            }
+        }
+
+        for (int q = 0; q < 3; ++q) {
+            const double *x = _row[q].data();
+            double *mean = _moments[q].mean.data() + offset;
+            double *m2 = _moments[q].m2.data() + offset;
+            double *min = _moments[q].min.data() + offset;
+            double *max = _moments[q].max.data() + offset;
+            for (int i = 0; i < _imax; ++i) {
+                double d = x[i] - mean[i];
+                mean[i] += f * d;
+                m2[i] += weight * d * (x[i] - mean[i]);
+                min[i] = std::min(min[i], x[i]);
+                max[i] = std::max(max[i], x[i]);
+            }
+        }
+    }
+}
+
+int Statistics::samples() const { return _samples; }
+
+double Statistics::time() const { return _weight; }
+
+bool Statistics::stresses() const { return _stresses; }
+
+double Statistics::mean(Quantity q, int i, int j) const { return _moments[q].mean[index(i, j)]; }
+
+double Statistics::variance(Quantity q, int i, int j) const {
+    return (_weight > 0.0) ? _moments[q].m2[index(i, j)] / _weight : 0.0;
+}
+
+double Statistics::rms(Quantity q, int i, int j) const { return std::sqrt(variance(q, i, j)); }
+
+double Statistics::min(Quantity q, int i, int j) const { return _moments[q].min[index(i, j)]; }
+
+double Statistics::max(Quantity q, int i, int j) const { return _moments[q].max[index(i, j)]; }
+
+double Statistics::covariance(int i, int j) const {
+    return (_stresses && _weight > 0.0) ? _cuv[index(i, j)] / _weight : 0.0;
+}
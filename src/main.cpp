@@ -4,17 +4,64 @@ date file is provided.
 */
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "Case.hpp"
+#include "Communication.hpp"
+#include "Ensemble.hpp"
+#include "Snapshot.hpp"
 
 int main(int argn, char **args) {
+  Communication::init_parallel(argn, args);
+
+  // Conversion of compressed snapshots to VTK:
+  // --decode <snapshot files>
+  if (argn > 1 && std::string(args[1]) == "--decode") {
+    std::vector<std::string> file_names(args + 2, args + argn);
+    int failed = SnapshotCodec::convert(file_names);
+    Communication::finalize();
+    return failed == 0 ? 0 : 1;
+  }
+
   if (argn > 1) {
     std::string file_name{args[1]};
-    Case problem(file_name, argn, args);
-    problem.simulate();
+
+    // Optional parameter study:
+    // --ensemble <variants file> [--threads <n>] [--batch]
+    std::string ensemble_file;
+    int threads = 0;
+    bool batch = false;
+    for (int i = 2; i < argn; i++) {
+      std::string option{args[i]};
+      if (option == "--ensemble" && i + 1 < argn) {
+        ensemble_file = args[++i];
+      } else if (option == "--threads" && i + 1 < argn) {
+        threads = std::stoi(args[++i]);
+      } else if (option == "--batch") {
+        batch = true;
+      } else {
+        std::cout << "Unknown option " << option << std::endl;
+      }
+    }
+
+    if (ensemble_file.empty()) {
+      Case problem(file_name, argn, args);
+      problem.simulate();
+    } else {
+      Ensemble ensemble(file_name, ensemble_file, threads, batch);
+      ensemble.run();
+    }
   } else {
     std::cout << "Error: No input file is provided to fluidchen." << std::endl;
     std::cout << "Example usage: /path/to/fluidchen /path/to/input_data.dat"
               << std::endl;
+    std::cout << "Parameter study: /path/to/fluidchen /path/to/input_data.dat "
+                 "--ensemble /path/to/variants.txt [--threads n] [--batch]"
+              << std::endl;
+    std::cout << "Snapshot conversion: /path/to/fluidchen --decode "
+                 "/path/to/snapshots.fcs ..."
+              << std::endl;
   }
+
+  Communication::finalize();
 }